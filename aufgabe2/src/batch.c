@@ -0,0 +1,263 @@
+/**
+ * @file batch.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This file contains the file mode of the calculator. It maps an input file into memory and calculates slices of it in parallel threads
+ * @date 19.10.2026
+ */
+
+#include "calculator.h"
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * @brief the initial size of the output buffer of a slice
+ */
+#define OUTPUT_INITIAL_CAPACITY	(64 * 1024)
+
+/**
+ * @brief a newline aligned part of the input file and the results of its lines
+ */
+struct slice {
+	/*! @brief the first character of the slice*/
+	const char *start;
+	/*! @brief the position after the last character of the slice*/
+	const char *end;
+	/*! @brief the results of the lines, each terminated by a newline*/
+	char *output;
+	/*! @brief the number of characters in output*/
+	size_t output_length;
+	/*! @brief the allocated size of output*/
+	size_t output_capacity;
+	/*! @brief the number of calculated lines*/
+	size_t lines;
+	/*! @brief the description of the error in the line after the calculated lines or NULL*/
+	const char *error;
+	/*! @brief the thread that calculates the slice*/
+	pthread_t thread;
+};
+
+/**
+ * @brief the file descriptor of the input file
+ */
+static int input_fd = -1;
+
+/**
+ * @brief the memory mapped input file
+ */
+static char *input = MAP_FAILED;
+
+/**
+ * @brief the size of the input file
+ */
+static size_t input_size;
+
+/**
+ * @brief the slices that are calculated in one round
+ */
+static struct slice slices[BATCH_MAX_THREADS];
+
+/* STATIC FUNCTIONS */
+
+/**
+ * @brief free all resources of the file mode
+ * @details global variables: input, input_fd, slices
+ */
+static void free_batch_resources( void ){
+	DEBUG("Start closing file mode\n");
+	for(int i = 0; i < BATCH_MAX_THREADS; ++i){
+		free(slices[i].output);
+		slices[i].output = NULL;
+	}
+	if(input != MAP_FAILED && munmap(input, input_size) != 0){
+		int errcode = errno;
+		(void) fprintf(stderr, "%s: ", program_name);
+		(void) fprintf(stderr,"unmapping the input file error. Code: %s\n", strerror(errcode));
+	}
+	input = MAP_FAILED;
+	if(input_fd >= 0 && close(input_fd) != 0){
+		int errcode = errno;
+		(void) fprintf(stderr, "%s: ", program_name);
+		(void) fprintf(stderr,"closing the input file error. Code: %s\n", strerror(errcode));
+	}
+	input_fd = -1;
+	DEBUG("file mode closed\n");
+}
+
+/**
+ * @brief exits the file mode and closes all resources
+ * @param eval the exit code
+ * @param msg the message to print
+ */
+static void bail_out_batch(int eval, const char *msg){
+	int errcode = errno;
+	free_batch_resources();
+	errno = errcode;
+	bail_out(eval, "%s", msg);
+}
+
+/**
+ * @brief doubles the output buffer of a slice
+ * @param slice the slice
+ * @return 0 on success, -1 if no memory is left
+ */
+static int grow_output(struct slice *slice){
+	size_t capacity = slice->output_capacity == 0 ? OUTPUT_INITIAL_CAPACITY : slice->output_capacity * 2;
+	char *output = realloc(slice->output, capacity);
+	if(output == NULL){
+		return -1;
+	}
+	slice->output = output;
+	slice->output_capacity = capacity;
+	return 0;
+}
+
+/**
+ * @brief calculates all lines of a slice and appends the results to its output
+ * @details stops at the first line that can not be calculated and sets the error of the slice
+ * @param argument the slice
+ * @return NULL
+ */
+static void *calculate_slice(void *argument){
+	struct slice *slice = argument;
+	const char *line = slice->start;
+
+	slice->output_length = 0;
+	slice->lines = 0;
+	slice->error = NULL;
+
+	while(line < slice->end){
+		const char *newline = memchr(line, '\n', slice->end - line);
+		const char *line_end = newline == NULL ? slice->end : newline;
+		long operand1;
+		long operand2;
+		operator op;
+
+		/* a result with its newline needs at most RESULT_BUFFER_LENGTH characters */
+		if(slice->output_capacity - slice->output_length < RESULT_BUFFER_LENGTH
+			&& grow_output(slice) < 0){
+			slice->error = "no memory left for the results";
+			return NULL;
+		}
+		if(parse_expression(line, line_end - line, &operand1, &operand2, &op, &slice->error) < 0){
+			return NULL;
+		}
+		int length = calculate(operand1, operand2, op, slice->output + slice->output_length);
+		if(length < 0){
+			slice->error = "division by zero";
+			return NULL;
+		}
+		slice->output_length += length;
+		slice->output[slice->output_length++] = '\n';
+		++slice->lines;
+		line = line_end + 1;
+	}
+	return NULL;
+}
+
+/**
+ * @brief maps the input file into memory
+ * @param path the path of the input file
+ * @details global variables: input, input_fd, input_size
+ */
+static void map_input(const char *path){
+	struct stat info;
+
+	input_fd = open(path, O_RDONLY);
+	if(input_fd < 0){
+		bail_out_batch(EXIT_FAILURE,"opening the input file failed");
+	}
+	if(fstat(input_fd, &info) != 0){
+		bail_out_batch(EXIT_FAILURE,"fstat of the input file failed");
+	}
+	input_size = info.st_size;
+	if(input_size == 0){
+		return;
+	}
+	input = mmap(NULL, input_size, PROT_READ, MAP_PRIVATE, input_fd, 0);
+	if(input == MAP_FAILED){
+		bail_out_batch(EXIT_FAILURE,"mapping the input file failed");
+	}
+	(void) madvise(input, input_size, MADV_SEQUENTIAL);
+}
+
+/* IMPLEMENTATIONS */
+
+void batchProcess( const char *path ){
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t line_number = 0;
+
+	if(threads < 1){
+		threads = 1;
+	} else if(threads > BATCH_MAX_THREADS){
+		threads = BATCH_MAX_THREADS;
+	}
+
+	DEBUG("starting file mode with %ld threads\n", threads);
+
+	map_input(path);
+
+	const char *position = input;
+	const char *end = input + input_size;
+
+	while(position < end){
+		int count;
+
+		/* split the next round into newline aligned slices */
+		for(count = 0; count < threads && position < end; ++count){
+			struct slice *slice = &slices[count];
+			slice->start = position;
+			if(end - position <= BATCH_SLICE_SIZE){
+				slice->end = end;
+			} else{
+				const char *newline = memchr(position + BATCH_SLICE_SIZE, '\n',
+					end - position - BATCH_SLICE_SIZE);
+				slice->end = newline == NULL ? end : newline + 1;
+			}
+			position = slice->end;
+		}
+
+		/* the first slice of a round is calculated by this thread */
+		for(int i = 1; i < count; ++i){
+			int error = pthread_create(&slices[i].thread, NULL, calculate_slice, &slices[i]);
+			if(error != 0){
+				/* the threads of this round still read the mapped input */
+				for(int j = 1; j < i; ++j){
+					(void) pthread_join(slices[j].thread, NULL);
+				}
+				errno = error;
+				bail_out_batch(EXIT_FAILURE,"creating a thread failed");
+			}
+		}
+		(void) calculate_slice(&slices[0]);
+		for(int i = 1; i < count; ++i){
+			(void) pthread_join(slices[i].thread, NULL);
+		}
+
+		for(int i = 0; i < count; ++i){
+			/* the results of the lines before an error are printed like in the other modes */
+			if(fwrite(slices[i].output, 1, slices[i].output_length, stdout) != slices[i].output_length){
+				bail_out_batch(EXIT_FAILURE,"writing to stdout failed");
+			}
+			if(slices[i].error != NULL){
+				char msg[128];
+				(void) snprintf(msg, sizeof(msg), "line %lu: %s",
+					(unsigned long) (line_number + slices[i].lines + 1), slices[i].error);
+				if(fflush(stdout) != 0){
+					bail_out_batch(EXIT_FAILURE,"flushing stdout failed");
+				}
+				errno = 0;
+				usage();
+				bail_out_batch(EXIT_FAILURE, msg);
+			}
+			line_number += slices[i].lines;
+		}
+	}
+
+	if(fflush(stdout) != 0){
+		bail_out_batch(EXIT_FAILURE,"flushing stdout failed");
+	}
+
+	free_batch_resources();
+}
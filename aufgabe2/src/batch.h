@@ -0,0 +1,39 @@
+/**
+ * @file batch.h
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This headerfile contains the Prototypes, Constants and Macros of "batch.c"
+ * @date 19.10.2026
+ */
+
+/**
+ * prevent multible inclusion
+ */
+#ifndef dp_batch_h
+#define dp_batch_h
+
+#include "calculator.h"
+
+/* CONSTANTS */
+
+/**
+ * @brief The size of one slice of the input file that is calculated by one thread
+ * @details slices end at the next newline after this size
+ */
+#define BATCH_SLICE_SIZE		(4 * 1024 * 1024)
+
+/**
+ * @brief The maximum number of threads that calculate slices at the same time
+ */
+#define BATCH_MAX_THREADS		(64)
+
+/* PROTOTYPES */
+
+/**
+ * @brief the main function of the file mode. this method is called from the main function of calculator
+ * @details maps the file into memory and calculates newline aligned slices of it in parallel threads.
+ * The results are written to stdout in the order of the input lines
+ * @param path the path of the input file
+ */
+void batchProcess( const char *path );
+
+#endif /*ifndef dp_batch_h*/
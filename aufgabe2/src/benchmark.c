@@ -0,0 +1,513 @@
+/**
+ * @file benchmark.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This program drives a calculator with a generated workload and measures the round-trip latency and the throughput
+ * @date 19.10.2026
+ *
+ * The latency is measured in lockstep: one expression is sent and its result is awaited before the next one.
+ * The throughput is measured with all expressions in flight at once. The calculator is either spawned
+ * and connected through pipes or reached through the unix domain socket of its daemon mode.
+ */
+
+#include "benchmark.h"
+
+/**
+ * @brief Program name for usage and error messages
+ */
+static const char *program_name;
+
+/**
+ * @brief the state of the workload generator
+ */
+static uint64_t random_state;
+
+/* STATIC FUNCTIONS */
+
+/**
+ * @brief terminate program on program error and print error message
+ * @details if errno is set it is printed too
+ * @param eval the exit code
+ * @param fmt format string to print
+ */
+static void bail_out(int eval, const char *fmt, ...){
+	va_list ap;
+
+	(void) fprintf(stderr, "%s: ", program_name);
+	if (fmt != NULL) {
+		va_start(ap,fmt);
+		(void) vfprintf(stderr, fmt, ap);
+		va_end(ap);
+	}
+	if (errno != 0){
+		(void) fprintf(stderr, ": %s", strerror(errno));
+	}
+	(void) fprintf(stderr, "\n");
+
+	exit(eval);
+}
+
+/**
+ * @brief This function prints the usage information (SYNOPSIS) onto stderr and exits
+ */
+static void usage(void){
+	errno = 0;
+	bail_out(EXIT_FAILURE, "SYNOPSIS:\n"
+	"\tbenchmark [-n <count>] [-r <seed>] -s <socket>\n"
+	"\tbenchmark [-n <count>] [-r <seed>] <calculator> [<arguments>]\n"
+	"\t-n:\tnumber of expressions of each measurement (default: %d)\n"
+	"\t-r:\tseed of the workload generator (default: %d)\n"
+	"\t-s:\tmeasure the daemon listening on <socket> instead of spawning <calculator>\n"
+	"\t<arguments> are passed to <calculator>, e.g. -t",
+	BENCH_DEFAULT_COUNT, BENCH_DEFAULT_SEED);
+}
+
+/**
+ * @brief parses a positive number of a command line option
+ * @param arg the option argument
+ * @return the number
+ */
+static unsigned long parse_number(const char *arg){
+	char *endptr;
+	errno = 0;
+	unsigned long value = strtoul(arg, &endptr, 10);
+	if(errno != 0 || endptr == arg || *endptr != '\0' || value == 0){
+		usage();
+	}
+	return value;
+}
+
+/**
+ * @brief returns the next pseudo random number (xorshift64*)
+ * @return the random number
+ */
+static uint64_t next_random(void){
+	random_state ^= random_state >> 12;
+	random_state ^= random_state << 25;
+	random_state ^= random_state >> 27;
+	return random_state * 2685821657736338717ULL;
+}
+
+/**
+ * @brief returns a random operand, mostly small and sometimes as large as a long allows
+ * @param nonzero true if the operand must not be zero
+ * @return the operand
+ */
+static long random_operand(bool nonzero){
+	long value;
+	do {
+		uint64_t r = next_random();
+		if(r % BENCH_LARGE_EVERY == 0){
+			/* the low bits of r are 0 here, the sign takes a draw of its own */
+			value = (long) (r >> 1) * ((next_random() >> 63) ? -1 : 1);
+		} else{
+			value = (long) ((r >> 32) % 20001) - 10000;
+		}
+	} while(nonzero && value == 0);
+	return value;
+}
+
+/**
+ * @brief generates the expressions of a measurement
+ * @param workload the workload to fill
+ * @param count the number of expressions
+ */
+static void generate_workload(struct workload *workload, size_t count){
+	/* "<zahl1> <zahl2> <operator>\n" with 20 characters per number at most */
+	const size_t max_length = 2 * 21 + 3;
+	const char operators[] = "+-*/";
+
+	workload->data = malloc(count * max_length);
+	workload->offsets = malloc((count + 1) * sizeof(size_t));
+	if(workload->data == NULL || workload->offsets == NULL){
+		bail_out(EXIT_FAILURE, "no memory left for the workload");
+	}
+	workload->count = count;
+
+	size_t length = 0;
+	for(size_t i = 0; i < count; ++i){
+		char op = operators[next_random() % 4];
+		long operand1 = random_operand(false);
+		long operand2 = random_operand(op == '/');
+		workload->offsets[i] = length;
+		length += sprintf(workload->data + length, "%ld %ld %c\n", operand1, operand2, op);
+	}
+	workload->offsets[count] = length;
+}
+
+/**
+ * @brief spawns the calculator and connects its stdin and stdout to pipes
+ * @param calculator the path of the calculator followed by its arguments, terminated by NULL
+ * @param target the connection to fill
+ */
+static void spawn_target(char *const *calculator, struct target *target){
+	int to_calculator[2];
+	int from_calculator[2];
+
+	if(pipe(to_calculator) != 0 || pipe(from_calculator) != 0){
+		bail_out(EXIT_FAILURE, "creation of the pipes failed");
+	}
+
+	target->pid = fork();
+	switch(target->pid){
+	case -1:
+		bail_out(EXIT_FAILURE, "can't fork");
+		break;
+	case 0:
+		if(dup2(to_calculator[0], STDIN_FILENO) < 0
+			|| dup2(from_calculator[1], STDOUT_FILENO) < 0){
+			bail_out(EXIT_FAILURE, "dup2 failed");
+		}
+		(void) close(to_calculator[0]);
+		(void) close(to_calculator[1]);
+		(void) close(from_calculator[0]);
+		(void) close(from_calculator[1]);
+		(void) execv(calculator[0], calculator);
+		bail_out(EXIT_FAILURE, "executing %s failed", calculator[0]);
+		break;
+	default:
+		break;
+	}
+
+	(void) close(to_calculator[0]);
+	(void) close(from_calculator[1]);
+	target->input = to_calculator[1];
+	target->output = from_calculator[0];
+}
+
+/**
+ * @brief connects to the daemon of the calculator
+ * @param path the path of the unix domain socket
+ * @param target the connection to fill
+ */
+static void connect_target(const char *path, struct target *target){
+	struct sockaddr_un address;
+
+	if(strlen(path) >= sizeof(address.sun_path)){
+		errno = ENAMETOOLONG;
+		bail_out(EXIT_FAILURE, "the path of the socket is too long");
+	}
+	(void) memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	(void) strcpy(address.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0){
+		bail_out(EXIT_FAILURE, "creating the socket failed");
+	}
+	if(connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0){
+		bail_out(EXIT_FAILURE, "connecting to %s failed", path);
+	}
+	target->input = fd;
+	target->output = fd;
+	target->pid = -1;
+}
+
+/**
+ * @brief opens a new connection to the calculator under test
+ * @param calculator the path of the calculator and its arguments or NULL
+ * @param socket_path the path of the socket of the daemon or NULL
+ * @param target the connection to fill
+ */
+static void open_target(char *const *calculator, const char *socket_path, struct target *target){
+	if(socket_path != NULL){
+		connect_target(socket_path, target);
+	} else{
+		spawn_target(calculator, target);
+	}
+}
+
+/**
+ * @brief closes the connection to the calculator and waits for a spawned calculator
+ * @param target the connection
+ */
+static void close_target(struct target *target){
+	int status;
+
+	if(target->pid < 0){
+		(void) close(target->input);
+		return;
+	}
+	(void) close(target->input);
+	(void) close(target->output);
+	if(waitpid(target->pid, &status, 0) < 0){
+		bail_out(EXIT_FAILURE, "waitpid failed");
+	}
+	if(!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS){
+		errno = 0;
+		bail_out(EXIT_FAILURE, "the calculator failed");
+	}
+}
+
+/**
+ * @brief returns the current time of the monotonic clock
+ * @return the time in nanoseconds
+ */
+static uint64_t now(void){
+	struct timespec ts;
+	(void) clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief writes a whole buffer to a blocking file descriptor
+ * @param fd the file descriptor
+ * @param data the buffer
+ * @param length the length of the buffer
+ */
+static void write_all(int fd, const char *data, size_t length){
+	while(length > 0){
+		ssize_t written = write(fd, data, length);
+		if(written < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			bail_out(EXIT_FAILURE, "writing to the calculator failed");
+		}
+		data += written;
+		length -= written;
+	}
+}
+
+/**
+ * @brief reads from the calculator and counts the received results
+ * @param fd the file descriptor
+ * @return the number of newlines received
+ */
+static size_t read_results(int fd){
+	static char buffer[BENCH_READ_SIZE];
+	ssize_t received;
+
+	do {
+		received = read(fd, buffer, sizeof(buffer));
+	} while(received < 0 && errno == EINTR);
+	if(received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+		return 0;
+	}
+	if(received <= 0){
+		bail_out(EXIT_FAILURE, "the calculator closed its output early");
+	}
+
+	size_t lines = 0;
+	const char *position = buffer;
+	const char *end = buffer + received;
+	while((position = memchr(position, '\n', end - position)) != NULL){
+		++lines;
+		++position;
+	}
+	return lines;
+}
+
+/**
+ * @brief compares two latencies for qsort
+ * @param a the first latency
+ * @param b the second latency
+ * @return the order of a and b
+ */
+static int compare_latency(const void *a, const void *b){
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief prints a latency in a readable unit
+ * @param label the label of the line
+ * @param ns the latency in nanoseconds
+ */
+static void print_latency(const char *label, uint64_t ns){
+	(void) printf("  %-6s %10.2f us\n", label, ns / 1000.0);
+}
+
+/**
+ * @brief sends every expression alone and waits for its result
+ * @details prints the percentiles and a power of two histogram of the round-trip latencies
+ * @param workload the expressions
+ * @param target the calculator under test
+ */
+static void measure_latency(const struct workload *workload, const struct target *target){
+	uint64_t *latencies = malloc(workload->count * sizeof(uint64_t));
+	unsigned long buckets[BENCH_BUCKETS] = {0};
+
+	if(latencies == NULL){
+		bail_out(EXIT_FAILURE, "no memory left for the latencies");
+	}
+
+	uint64_t total_start = now();
+	for(size_t i = 0; i < workload->count; ++i){
+		const char *expression = workload->data + workload->offsets[i];
+		size_t length = workload->offsets[i + 1] - workload->offsets[i];
+
+		uint64_t start = now();
+		write_all(target->input, expression, length);
+		while(read_results(target->output) == 0){
+			/* the result is not complete yet */
+		}
+		latencies[i] = now() - start;
+	}
+	uint64_t total = now() - total_start;
+
+	for(size_t i = 0; i < workload->count; ++i){
+		int bucket = 0;
+		while(bucket < BENCH_BUCKETS - 1 && (latencies[i] >> (bucket + 1)) != 0){
+			++bucket;
+		}
+		++buckets[bucket];
+	}
+	qsort(latencies, workload->count, sizeof(uint64_t), compare_latency);
+
+	(void) printf("latency (lockstep, %lu expressions, %.0f expressions/s)\n",
+		(unsigned long) workload->count, workload->count * 1e9 / total);
+	print_latency("min", latencies[0]);
+	print_latency("p50", latencies[workload->count / 2]);
+	print_latency("p99", latencies[workload->count * 99 / 100]);
+	print_latency("p999", latencies[workload->count * 999 / 1000]);
+	print_latency("max", latencies[workload->count - 1]);
+	(void) printf("  histogram:\n");
+	for(int i = 0; i < BENCH_BUCKETS; ++i){
+		if(buckets[i] != 0){
+			(void) printf("    < %10.2f us %10lu\n", (2ULL << i) / 1000.0, buckets[i]);
+		}
+	}
+
+	free(latencies);
+}
+
+/**
+ * @brief sends all expressions while the results are read
+ * @details prints the sustained number of expressions per second
+ * @param workload the expressions
+ * @param target the calculator under test
+ */
+static void measure_throughput(const struct workload *workload, const struct target *target){
+	const char *data = workload->data;
+	size_t length = workload->offsets[workload->count];
+	size_t sent = 0;
+	size_t results = 0;
+
+	if(fcntl(target->input, F_SETFL, O_NONBLOCK) != 0
+		|| fcntl(target->output, F_SETFL, O_NONBLOCK) != 0){
+		bail_out(EXIT_FAILURE, "fcntl failed");
+	}
+
+	uint64_t start = now();
+	while(results < workload->count){
+		struct pollfd fds[2];
+		fds[0].fd = sent < length ? target->input : -1;
+		fds[0].events = POLLOUT;
+		fds[1].fd = target->output;
+		fds[1].events = POLLIN;
+
+		/* a socket is written and read through the same file descriptor */
+		if(fds[0].fd == fds[1].fd){
+			fds[1].events |= POLLOUT;
+			fds[0].fd = -1;
+		}
+		if(poll(fds, 2, -1) < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			bail_out(EXIT_FAILURE, "poll failed");
+		}
+
+		if(sent < length && ((fds[0].revents | fds[1].revents) & (POLLOUT | POLLERR))){
+			ssize_t written = write(target->input, data + sent, length - sent);
+			if(written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+				bail_out(EXIT_FAILURE, "writing to the calculator failed");
+			}
+			if(written > 0){
+				sent += written;
+			}
+		}
+		if(fds[1].revents & (POLLIN | POLLHUP | POLLERR)){
+			results += read_results(target->output);
+		}
+	}
+	uint64_t total = now() - start;
+
+	(void) printf("throughput (pipelined, %lu expressions)\n", (unsigned long) workload->count);
+	(void) printf("  %.0f expressions/s\n", workload->count * 1e9 / total);
+}
+
+/**
+ * @brief Parse command line options
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @param count the number of expressions
+ * @param calculator the path of the calculator followed by its arguments, terminated by NULL
+ * @param socket_path the path of the socket of the daemon
+ */
+static void parse_args(int argc, char **argv, size_t *count,
+	char *const **calculator, const char **socket_path){
+	int getopt_result;
+
+	*count = BENCH_DEFAULT_COUNT;
+	random_state = BENCH_DEFAULT_SEED;
+	*calculator = NULL;
+	*socket_path = NULL;
+
+	/* '+' stops at the calculator, its options are its own */
+	while ((getopt_result = getopt(argc, argv, "+n:r:s:")) != -1) {
+		switch (getopt_result) {
+		case 'n':
+			*count = parse_number(optarg);
+			break;
+		case 'r':
+			random_state = parse_number(optarg);
+			break;
+		case 's':
+			*socket_path = optarg;
+			break;
+		case '?':
+			usage();
+			break;
+		default:
+			assert(0);
+		}
+	}
+
+	if(*socket_path == NULL && optind < argc){
+		*calculator = &argv[optind];
+	} else if(optind != argc){
+		usage();
+	}
+	if(*socket_path == NULL && *calculator == NULL){
+		usage();
+	}
+}
+
+/* MAIN FUNCTION */
+
+/**
+ * @brief Generates one workload, measures the latency on one connection and the throughput on a second one
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on failure
+ */
+int main(int argc, char *argv[]){
+	struct workload workload;
+	struct target target;
+	char *const *calculator;
+	const char *socket_path;
+	size_t count;
+
+	program_name = argv[0];
+	parse_args(argc, argv, &count, &calculator, &socket_path);
+
+	/* a calculator that bailed out shows up as error of write */
+	(void) signal(SIGPIPE, SIG_IGN);
+
+	generate_workload(&workload, count);
+	DEBUG("generated %lu bytes of expressions\n", (unsigned long) workload.offsets[count]);
+
+	open_target(calculator, socket_path, &target);
+	measure_latency(&workload, &target);
+	close_target(&target);
+
+	open_target(calculator, socket_path, &target);
+	measure_throughput(&workload, &target);
+	close_target(&target);
+
+	free(workload.data);
+	free(workload.offsets);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file benchmark.h
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This headerfile contains the Prototypes, Constants and Macros of "benchmark.c"
+ * @date 19.10.2026
+ *
+ * Headerfile of the benchmark that measures the round-trip latency and the throughput of the calculator
+ */
+
+#ifndef dp_benchmark_h /*prevent multible inclusion*/
+#define dp_benchmark_h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <limits.h>
+#include <time.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/* CONSTANTS */
+
+/**
+ * @brief The default number of expressions of each measurement
+ */
+#define BENCH_DEFAULT_COUNT		(200000)
+
+/**
+ * @brief The default seed of the workload generator
+ */
+#define BENCH_DEFAULT_SEED		(2048)
+
+/**
+ * @brief Every n-th operand of the workload is a large number that lets results overflow a long
+ */
+#define BENCH_LARGE_EVERY		(16)
+
+/**
+ * @brief The size of the buffer that receives the results
+ */
+#define BENCH_READ_SIZE			(64 * 1024)
+
+/**
+ * @brief The number of power of two buckets of the latency histogram (1 ns up to about 1 s)
+ */
+#define BENCH_BUCKETS			(31)
+
+/* MACROS */
+
+/**
+ * @def DEBUG(...)
+ * @brief Prints formatted debug message to stderr
+ */
+#ifdef ENDEBUG /*Flag to set from compiler for debugging*/
+#define DEBUG(...) do { fprintf(stderr, __VA_ARGS__);} while(0)
+#else
+#define DEBUG(...)
+#endif
+
+/* TYPEDEF */
+
+/**
+ * @brief the generated expressions of a measurement
+ */
+struct workload {
+	/*! @brief all expressions, each terminated by a newline*/
+	char *data;
+	/*! @brief the start of each expression in data, with one extra entry for the end*/
+	size_t *offsets;
+	/*! @brief the number of expressions*/
+	size_t count;
+};
+
+/**
+ * @brief a connection to the calculator under test
+ */
+struct target {
+	/*! @brief the file descriptor expressions are written to*/
+	int input;
+	/*! @brief the file descriptor results are read from*/
+	int output;
+	/*! @brief the pid of the spawned calculator or -1 for a socket*/
+	pid_t pid;
+};
+
+#endif /*ifndef dp_benchmark_h*/
@@ -6,6 +6,7 @@
  */
 
 #include "calculator.h"
+#include <getopt.h>
 
 
 /* STATIC FUNCTIONS */
@@ -34,8 +35,11 @@ void bail_out(int eval, const char *fmt, ...){
 
 void usage(void){
 	(void) fprintf(stderr, "%s: SYNOPSIS:\n"
-	"\tcalculator\n"
-	"\t$> <zahl1> <zahl2> <operator>\n\n"
+	"\tcalculator [-t | -f <file> | -s <socket>]\n"
+	"\t$> <zahl1> <zahl2> <operator>\n"
+	"\t-t, --threads:\tuse a reader and an evaluator thread instead of a parent and a child process\n"
+	"\t-f:\tcalculate every line of <file> in parallel threads\n"
+	"\t-s:\trun as daemon that calculates the lines of the clients of the unix domain socket <socket>\n\n"
 	"BNF:\n"
 	"\t<zahl>\t::= -?[0-9]+\n"
 	"\t<operator>\t::= +|-|*/\n", program_name);
@@ -48,6 +52,9 @@ void usage(void){
  * The parent handles the input of the calculations and sends them
  * to the child process. This process parses the input and calculates
  * it. The result gets sent back to the parent and printed onto stdout.
+ * With -t the parent and the child are threads of one process, with -f the
+ * lines of a file are calculated by threads instead and with -s the program
+ * serves the clients of a unix domain socket.
  *
  * @param argc The argument counter
  * @param argv The argument vector
@@ -55,11 +62,56 @@ void usage(void){
  */
 int main(int argc, char *argv[]){
 
-	if(argc != 1){
+	const struct option long_options[] = {
+		{ "threads", no_argument, NULL, 't' },
+		{ NULL, 0, NULL, 0 }
+	};
+	const char *file = NULL;
+	const char *socket_path = NULL;
+	bool threads = false;
+	int modes = 0;
+	int getopt_result;
+
+	program_name = argv[0];
+
+	while ((getopt_result = getopt_long(argc, argv, "tf:s:", long_options, NULL)) != -1) {
+		switch (getopt_result) {
+		case 't':
+			threads = true;
+			++modes;
+			break;
+		case 'f':
+			file = optarg;
+			++modes;
+			break;
+		case 's':
+			socket_path = optarg;
+			++modes;
+			break;
+		case '?':
+			usage();
+			bail_out(EXIT_FAILURE,"wrong usage.");
+			break;
+		default:
+			assert(0);
+		}
+	}
+	if(optind < argc || modes > 1){
 		usage();
 		bail_out(EXIT_FAILURE,"wrong usage.");
-	} else{
-		program_name = argv[0];
+	}
+
+	if(file != NULL){
+		batchProcess(file);
+		exit(EXIT_SUCCESS);
+	}
+	if(socket_path != NULL){
+		serverProcess(socket_path);
+		exit(EXIT_SUCCESS);
+	}
+	if(threads){
+		threadedProcess();
+		exit(EXIT_SUCCESS);
 	}
 
 	if (pipe((int *)&pipes[PARENT]) != 0) {
@@ -20,19 +20,21 @@
 #include <errno.h>
 #include <assert.h>
 #include <limits.h>
+#include <stdbool.h>
 
+#include "input.h"
 #include "child.h"
 #include "parent.h"
+#include "batch.h"
+#include "server.h"
+#include "threads.h"
 /* CONSTANTS */
 
-/**
- * @brief The length of the input string that is received with stdin
- */
-#define INPUT_BUFFER_LENGTH		(15)
 /**
  * @brief the length of the result string from the child process
+ * @details a wide_long has at most 39 digits, plus sign, newline and '\0'
  */
-#define RESULT_BUFFER_LENGTH 	(15)
+#define RESULT_BUFFER_LENGTH 	(42)
 
 /**
  * @brief The index of the the pipe of the parent process
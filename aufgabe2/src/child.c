@@ -25,61 +25,203 @@ operator op;
 
 /* STATIC FUNCTIONS */
 
+/**
+ * @brief the buffer for the lines received from the parent process
+ */
+static struct line input_line;
+
+/**
+ * @brief moves the cursor over spaces and tabs
+ * @param cursor the position in the input string
+ * @param end the end of the input string
+ * @return the position of the next other character or end
+ */
+static const char *skip_blanks(const char *cursor, const char *end){
+	while(cursor < end && (*cursor == ' ' || *cursor == '\t')){
+		++cursor;
+	}
+	return cursor;
+}
+
 /**
  * @brief extract the operands and the operator from the input string
  * @details saves the operands into the global variables "operand1" and "operand2" and the operator into the global variable "op"
  * @param input the input string in the form: "<zahl1> <zahl2> <operator>"
+ * @param length the length of the input string
  */
-static void parse_arguments(char* input){
-	char *tokens = strtok(input, " ");
-	char* endptr;
+static void parse_arguments(const char *input, size_t length){
+	const char *error;
 
-	operand1 = strtol(tokens,&endptr, 10);
-	if(endptr == tokens){
+	if(parse_expression(input, length, &operand1, &operand2, &op, &error) < 0){
 		usage();
-		bail_out_child(EXIT_FAILURE,"parsing of operand 1 failed");
+		bail_out_child(EXIT_FAILURE,error);
 	}
-	if(operand1 < LONG_MIN || operand1 > LONG_MAX){
-		usage();
-		bail_out_child(EXIT_FAILURE,"parsing of operand 1 failed");
+
+	DEBUG("o1 = %ld, o2 = %ld, op = %d\n",operand1, operand2, op);
+
+}
+
+/**
+ * @brief writes the decimal representation of an unsigned magnitude backwards into a buffer
+ * @param magnitude the value to convert
+ * @param end the position after the last digit
+ * @return the position of the first digit
+ */
+static char *format_digits(unsigned long magnitude, char *end){
+	do {
+		*--end = (char) ('0' + magnitude % 10);
+		magnitude /= 10;
+	} while(magnitude != 0);
+	return end;
+}
+
+/**
+ * @brief writes the decimal representation of a long into result
+ * @param val the value to convert
+ * @param result the buffer for the result string
+ * @return the length of the result string
+ */
+static int format_long(long val, char *result){
+	char digits[RESULT_BUFFER_LENGTH];
+	char *end = digits + sizeof(digits);
+	/* negate in unsigned arithmetic, so LONG_MIN does not overflow */
+	unsigned long magnitude = val < 0 ? 0UL - (unsigned long) val : (unsigned long) val;
+	char *start = format_digits(magnitude, end);
+
+	if(val < 0){
+		*--start = '-';
 	}
-	
-	operand2 = strtol(strtok(NULL," "),&endptr, 10);
-	if(endptr == tokens){
-		usage();
-		bail_out_child(EXIT_FAILURE,"parsing of operand 2 failed");
+	int length = end - start;
+	(void) memcpy(result, start, length);
+	result[length] = '\0';
+	return length;
+}
+
+/**
+ * @brief writes the decimal representation of a wide_long into result
+ * @details the magnitude is split into blocks of 19 digits, so only two 128 bit divisions are needed
+ * @param val the value to convert
+ * @param result the buffer for the result string
+ * @return the length of the result string
+ */
+static int format_wide(wide_long val, char *result){
+	__extension__ typedef unsigned __int128 wide_ulong;
+	const unsigned long block = 10000000000000000000UL; /* 10^19 */
+	char digits[RESULT_BUFFER_LENGTH];
+	char *end = digits + sizeof(digits);
+	char *start = end;
+	wide_ulong magnitude = val < 0 ? 0 - (wide_ulong) val : (wide_ulong) val;
+
+	while(magnitude >= block){
+		char *block_start = format_digits((unsigned long) (magnitude % block), start);
+		/* pad inner blocks with leading zeros */
+		while(block_start > start - 19){
+			*--block_start = '0';
+		}
+		start = block_start;
+		magnitude /= block;
 	}
-	if(operand2 < LONG_MIN || operand2 > LONG_MAX){
-		usage();
-		bail_out_child(EXIT_FAILURE,"parsing of operand 2 failed");
+	start = format_digits((unsigned long) magnitude, start);
+
+	if(val < 0){
+		*--start = '-';
 	}
+	int length = end - start;
+	(void) memcpy(result, start, length);
+	result[length] = '\0';
+	return length;
+}
+
+/* IMPLEMENTATIONS */
+
+int parse_expression(const char *input, size_t length,
+	long *operand1, long *operand2, operator *op, const char **error){
+	const char *end = input + length;
+	const char *cursor = skip_blanks(input, end);
 
-	char *c_op = strtok(NULL, " ");
+	if(parse_long(&cursor, end, operand1) < 0){
+		*error = "parsing of operand 1 failed";
+		return -1;
+	}
+
+	cursor = skip_blanks(cursor, end);
+	if(parse_long(&cursor, end, operand2) < 0){
+		*error = "parsing of operand 2 failed";
+		return -1;
+	}
 
-	switch(c_op[0]){
+	cursor = skip_blanks(cursor, end);
+	if(cursor == end){
+		*error = "parsing of operator failed";
+		return -1;
+	}
+
+	switch(*cursor){
 		case '+':
-			op = plus;
+			*op = plus;
 			break;
 		case '-':
-			op = minus;
+			*op = minus;
 			break;
 		case '*':
-			op = time;
+			*op = times;
 			break;
 		case '/':
-			op = divide;
+			*op = divide;
 			break;
 		default:
-			usage();
-			bail_out_child(EXIT_FAILURE,"parsing of operator 2 failed");
-			break;
+			*error = "parsing of operator failed";
+			return -1;
 	}
 
-	DEBUG("o1 = %ld, o2 = %ld, op = %d\n",operand1, operand2, op);
-
+	if(skip_blanks(cursor + 1, end) != end){
+		*error = "further characters after the operator";
+		return -1;
+	}
+	return 0;
 }
 
-/* IMPLEMENTATIONS */
+int calculate(long operand1, long operand2, operator op, char *result){
+	long val;
+	wide_long wide;
+
+	switch (op){
+		case plus:
+			if(!__builtin_add_overflow(operand1, operand2, &val)){
+				return format_long(val, result);
+			}
+			wide = (wide_long) operand1 + operand2;
+			break;
+		case minus:
+			if(!__builtin_sub_overflow(operand1, operand2, &val)){
+				return format_long(val, result);
+			}
+			wide = (wide_long) operand1 - operand2;
+			break;
+		case times:
+			if(!__builtin_mul_overflow(operand1, operand2, &val)){
+				return format_long(val, result);
+			}
+			wide = (wide_long) operand1 * operand2;
+			break;
+		case divide:
+			if(operand2 == 0){
+				return -1;
+			}
+			/* LONG_MIN / -1 is the only quotient that does not fit into a long */
+			if(operand2 != -1 || operand1 != LONG_MIN){
+				return format_long(operand1 / operand2, result);
+			}
+			wide = -(wide_long) operand1;
+			break;
+		default:
+			assert(0);
+			return -1;
+	}
+
+	DEBUG("result overflows a long, using 128 bit\n");
+	return format_wide(wide, result);
+}
 
 void free_child_resources( void ){
 	DEBUG("Start closing child process\n");
@@ -93,6 +235,7 @@ void free_child_resources( void ){
 		(void) fprintf(stderr, "%s: ", program_name);
 		(void) fprintf(stderr,"closing reading pipe error. Code: %s\n", strerror(errcode));
 	}
+	free_line(&input_line);
 	DEBUG("child closed\n");
 }
 
@@ -125,34 +268,16 @@ void childProcess( void ){
 		bail_out_child(EXIT_FAILURE,"close + 2 failed");
 	}
 	
-	char readbuffer[INPUT_BUFFER_LENGTH + 2];
 	char result[RESULT_BUFFER_LENGTH + 1];
 
-	while(fgets(readbuffer, INPUT_BUFFER_LENGTH + 2 , reading) != NULL){
-		DEBUG("child received: %s\n",readbuffer);
-		
-		(void) parse_arguments(readbuffer);
-		
-		long val = 0;
-
-		switch (op){
-			case plus:
-				val = operand1 + operand2;
-				break;
-			case minus:
-				val = operand1 - operand2;
-				break;
-			case time:
-				val = operand1 * operand2;
-				break;
-			case divide:
-				val = operand1 / operand2;
-				break;
-			default:
-				assert(0);
-		}
+	while(read_line(reading, &input_line) == 0){
+		DEBUG("child received: %s\n",input_line.data);
+
+		(void) parse_arguments(input_line.data, input_line.length);
 
-		snprintf(result,RESULT_BUFFER_LENGTH,"%ld",val);
+		if(calculate(operand1, operand2, op, result) < 0){
+			bail_out_child(EXIT_FAILURE,"division by zero");
+		}
 		
 		if( fprintf(writing, "%s\n",result) < 0){
 			bail_out_child(EXIT_FAILURE,"writing to the parent pipe failed");
@@ -162,5 +287,9 @@ void childProcess( void ){
 		}
 	}
 
+	if( feof(reading) == 0 ){
+		bail_out_child(EXIT_FAILURE,"reading from the parent pipe failed");
+	}
+
 	free_child_resources();
 }
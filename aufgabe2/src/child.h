@@ -30,9 +30,15 @@ typedef enum {
 	/*! @brief division*/
 	divide,
 	/*! @brief multiplication*/
-	time
+	times
 } operator;
 
+/**
+ * @brief signed 128 bit integer that holds results which overflow a long
+ * @details every sum, difference, product and quotient of two longs fits into it
+ */
+__extension__ typedef __int128 wide_long;
+
 /* GLOBAL VARIABLES */
 
 /**
@@ -58,6 +64,31 @@ void bail_out_child(int eval, const char * fmt, ...);
  */
 void free_child_resources( void );
 
+/**
+ * @brief extract the operands and the operator from an input string
+ * @param input the input string in the form: "<zahl1> <zahl2> <operator>"
+ * @param length the length of the input string
+ * @param operand1 the parsed first operand
+ * @param operand2 the parsed second operand
+ * @param op the parsed operator
+ * @param error is set to a description of the problem if the input is not valid
+ * @return 0 on success, -1 if the input is not valid
+ */
+int parse_expression(const char *input, size_t length,
+	long *operand1, long *operand2, operator *op, const char **error);
+
+/**
+ * @brief calculates "operand1 op operand2" without overflow and writes the decimal result into result
+ * @details the calculation is done with the overflow builtins in a long. Only if they report an overflow the result
+ * gets calculated and formatted as wide_long
+ * @param operand1 the first operand
+ * @param operand2 the second operand
+ * @param op the operator
+ * @param result the buffer for the result string with at least RESULT_BUFFER_LENGTH bytes
+ * @return the length of the result string or -1 if the second operand of a division is zero
+ */
+int calculate(long operand1, long operand2, operator op, char *result);
+
 /**
  * @brief the main function of the child process. this method is called from the main function of calculator 
  * @details pipes the pipes for the communication between the child process and the parent process
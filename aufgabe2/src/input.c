@@ -0,0 +1,154 @@
+/**
+ * @file input.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This file contains the line reader and the number parser that are shared by the parent and the child process
+ * @date 19.10.2026
+ */
+
+#include "calculator.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/* STATIC FUNCTIONS */
+
+/**
+ * @brief doubles the capacity of a line buffer
+ * @param line the line buffer
+ * @return 0 on success, -1 if no memory is left
+ */
+static int grow_line(struct line *line){
+	size_t capacity = line->capacity == 0 ? LINE_INITIAL_CAPACITY : line->capacity * 2;
+	if(capacity < line->capacity){
+		errno = ENOMEM;
+		return -1;
+	}
+	char *data = realloc(line->data, capacity);
+	if(data == NULL){
+		return -1;
+	}
+	line->data = data;
+	line->capacity = capacity;
+	return 0;
+}
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/**
+ * @brief checks if all eight bytes of chunk are the characters '0' to '9'
+ * @param chunk eight characters loaded as little endian integer
+ * @return true if all characters are digits
+ */
+static bool is_eight_digits(uint64_t chunk){
+	return ((chunk & 0xF0F0F0F0F0F0F0F0ULL)
+		| (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+		== 0x3333333333333333ULL;
+}
+
+/**
+ * @brief converts eight digit characters into their value
+ * @details the digits are combined pairwise, then to groups of four and then to eight with three multiplications
+ * @param chunk eight digit characters loaded as little endian integer
+ * @return the value of the eight digits
+ */
+static uint32_t eight_digits_value(uint64_t chunk){
+	const uint64_t mask = 0x000000FF000000FFULL;
+	const uint64_t mul1 = 100 + (1000000ULL << 32);
+	const uint64_t mul2 = 1 + (10000ULL << 32);
+
+	chunk -= 0x3030303030303030ULL;
+	chunk = (chunk * 10) + (chunk >> 8);
+	chunk = (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32;
+	return (uint32_t) chunk;
+}
+#endif
+
+/* IMPLEMENTATIONS */
+
+int read_line(FILE *stream, struct line *line){
+	size_t length = 0;
+	int c;
+
+	if(line->capacity == 0 && grow_line(line) < 0){
+		return -1;
+	}
+
+	/* the bytes are counted here, strlen would stop at a '\0' inside of the line */
+	flockfile(stream);
+	while((c = getc_unlocked(stream)) != EOF && c != '\n'){
+		if(c == '\0'){
+			funlockfile(stream);
+			errno = EINVAL;
+			return -1;
+		}
+		if(length + 1 == line->capacity && grow_line(line) < 0){
+			funlockfile(stream);
+			return -1;
+		}
+		line->data[length++] = (char) c;
+	}
+	funlockfile(stream);
+
+	/* the last line of a stream does not need a newline */
+	if(c == EOF && (length == 0 || ferror(stream))){
+		return -1;
+	}
+	line->data[length] = '\0';
+	line->length = length;
+	return 0;
+}
+
+void free_line(struct line *line){
+	free(line->data);
+	line->data = NULL;
+	line->length = 0;
+	line->capacity = 0;
+}
+
+int parse_long(const char **cursor, const char *end, long *value){
+	const char *position = *cursor;
+	bool negative = false;
+	unsigned long magnitude = 0;
+
+	if(position < end && *position == '-'){
+		negative = true;
+		++position;
+	}
+	const char *digits = position;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	while(end - position >= 8){
+		uint64_t chunk;
+		(void) memcpy(&chunk, position, sizeof(chunk));
+		if(!is_eight_digits(chunk)){
+			break;
+		}
+		if(__builtin_mul_overflow(magnitude, 100000000UL, &magnitude)
+			|| __builtin_add_overflow(magnitude, eight_digits_value(chunk), &magnitude)){
+			return -1;
+		}
+		position += 8;
+	}
+#endif
+	while(position < end && *position >= '0' && *position <= '9'){
+		if(__builtin_mul_overflow(magnitude, 10UL, &magnitude)
+			|| __builtin_add_overflow(magnitude, (unsigned long) (*position - '0'), &magnitude)){
+			return -1;
+		}
+		++position;
+	}
+
+	if(position == digits){
+		return -1;
+	}
+	if(magnitude > (unsigned long) LONG_MAX + negative){
+		return -1;
+	}
+
+	if(negative && magnitude != 0){
+		/* -(LONG_MAX + 1) is built without overflowing a long */
+		*value = -(long) (magnitude - 1) - 1;
+	} else{
+		*value = (long) magnitude;
+	}
+	*cursor = position;
+	return 0;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file input.h
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This headerfile contains the Prototypes, Constants and Macros of "input.c"
+ * @date 19.10.2026
+ *
+ * The line reader and the number parser are used by the parent and the child process
+ */
+
+/**
+ * prevent multible inclusion
+ */
+#ifndef dp_input_h
+#define dp_input_h
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* CONSTANTS */
+
+/**
+ * @brief The initial capacity of a line buffer
+ * @details the buffer doubles its capacity whenever a line does not fit
+ */
+#define LINE_INITIAL_CAPACITY	(64)
+
+/* TYPEDEF */
+
+/**
+ * @brief a growable buffer that holds one line of a stream
+ */
+struct line {
+	/*! @brief the characters of the line without the newline, terminated by '\0'*/
+	char *data;
+	/*! @brief the number of characters in data without the terminating '\0'*/
+	size_t length;
+	/*! @brief the allocated size of data*/
+	size_t capacity;
+};
+
+/* PROTOTYPES */
+
+/**
+ * @brief reads the next line of a stream into a line buffer. The line may be of any length
+ * @details the buffer grows if the line does not fit. The newline gets removed
+ * @param stream the stream to read from
+ * @param line the line buffer, zero initialised before the first call
+ * @return 0 on success, -1 on end of file, on a read error, on a '\\0' in the line (errno is EINVAL) or if no memory is left (errno is set)
+ */
+int read_line(FILE *stream, struct line *line);
+
+/**
+ * @brief frees the memory of a line buffer
+ * @param line the line buffer
+ */
+void free_line(struct line *line);
+
+/**
+ * @brief parses a decimal number of the form -?[0-9]+ into a long
+ * @details runs of eight digits are converted at once (SWAR). The value is range checked
+ * @param cursor the position to start parsing. It is moved behind the number on success
+ * @param end the end of the string
+ * @param value the parsed number
+ * @return 0 on success, -1 if there is no number at cursor or it does not fit into a long
+ */
+int parse_long(const char **cursor, const char *end, long *value);
+
+#endif /*ifndef dp_input_h*/
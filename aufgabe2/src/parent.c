@@ -1,48 +1,145 @@
 /**
  * @file parent.c
  * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
- * @brief This file contains the implementation of the parent process of the calculator. It waits for user input on the stdin and prints the output from the child process to the stdout 
+ * @brief This file contains the implementation of the parent process of the calculator. It waits for user input on the stdin and prints the output from the child process to the stdout
  * @date 27.04.2014
  */
 
 #include "calculator.h"
+#include <stdbool.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
 
+/**
+ * @brief a bounded buffer of bytes that still have to be written
+ */
+struct queue {
+	/*! @brief the bytes of the queue*/
+	char data[PARENT_QUEUE_SIZE];
+	/*! @brief the position of the first pending byte*/
+	size_t start;
+	/*! @brief the position after the last pending byte*/
+	size_t end;
+};
+
+/**
+ * @brief the lines from stdin that are not yet sent to the child process
+ */
+static struct queue to_child;
+
+/**
+ * @brief the results of the child process that are not yet printed to stdout
+ */
+static struct queue to_stdout;
+
+/**
+ * @brief the write end of the pipe to the child process or -1 if it is closed
+ */
+static int child_input = -1;
+
+/**
+ * @brief the read end of the pipe from the child process or -1 if it is closed
+ */
+static int child_output = -1;
+
+/**
+ * @brief the maximum number of bytes written to stdout at once
+ */
+static size_t stdout_limit = PARENT_QUEUE_SIZE;
 
 /* STATIC FUNCTIONS */
 
-void free_parent_resources( void ){
-	pid_t pid;
-	int status;
+/**
+ * @brief returns the free space at the end of a queue
+ * @details moves the pending bytes to the beginning once less than half of the queue is free
+ * @param queue the queue
+ * @return the number of free bytes at the end of the queue
+ */
+static size_t queue_space(struct queue *queue){
+	if(queue->start > 0 && queue->end > PARENT_QUEUE_SIZE / 2){
+		(void) memmove(queue->data, queue->data + queue->start, queue->end - queue->start);
+		queue->end -= queue->start;
+		queue->start = 0;
+	}
+	return PARENT_QUEUE_SIZE - queue->end;
+}
 
-	DEBUG("Start closing parent process\n");
+/**
+ * @brief reads the available bytes of a file descriptor into a queue
+ * @param fd the file descriptor, it has to be ready for reading
+ * @param queue the queue
+ * @param reserve the number of bytes that have to stay free
+ * @return the number of bytes read, 0 on end of file, -1 on error
+ */
+static ssize_t fill_queue(int fd, struct queue *queue, size_t reserve){
+	ssize_t received = read(fd, queue->data + queue->end, queue_space(queue) - reserve);
+	if(received > 0){
+		queue->end += received;
+	}
+	return received;
+}
 
-	if( fclose(writing) != 0){
-		int errcode = errno;
-		(void) fprintf(stderr, "%s: ", program_name);
-		(void) fprintf(stderr,"closing writing pipe error. Code: %s\n", strerror(errcode));
+/**
+ * @brief writes pending bytes of a queue to a file descriptor
+ * @param fd the file descriptor, it has to be ready for writing
+ * @param queue the queue
+ * @param limit the maximum number of bytes to write at once
+ * @return 0 on success, -1 on error
+ */
+static int drain_queue(int fd, struct queue *queue, size_t limit){
+	size_t pending = queue->end - queue->start;
+	ssize_t written = write(fd, queue->data + queue->start, pending < limit ? pending : limit);
+	if(written < 0){
+		return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
 	}
-	if( fclose(reading) != 0){
+	queue->start += written;
+	if(queue->start == queue->end){
+		queue->start = 0;
+		queue->end = 0;
+	}
+	return 0;
+}
+
+/**
+ * @brief closes a pipe end and marks it as closed
+ * @param fd the pipe end
+ */
+static void close_pipe(int *fd){
+	if(*fd >= 0 && close(*fd) != 0){
 		int errcode = errno;
 		(void) fprintf(stderr, "%s: ", program_name);
-		(void) fprintf(stderr,"closing reading pipe error. Code: %s\n", strerror(errcode));
+		(void) fprintf(stderr,"closing pipe error. Code: %s\n", strerror(errcode));
 	}
-	
+	*fd = -1;
+}
+
+/* IMPLEMENTATIONS */
+
+void free_parent_resources( void ){
+	pid_t pid;
+	int status;
+
+	DEBUG("Start closing parent process\n");
+
+	close_pipe(&child_input);
+	close_pipe(&child_output);
+
 	DEBUG("Wait for the child to close\n");
 
 	pid = wait(&status);
-	
+
 	if(WEXITSTATUS(status) != EXIT_SUCCESS){
 		(void) fprintf(stderr, "%s: ", program_name);
 		(void) fprintf(stderr,"child with pid %d returned exit code %d.\n", pid, WEXITSTATUS(status));
 		exit(EXIT_FAILURE);
 	}
-	
+
 
 	DEBUG("parent closed\n");
 }
 
-/* IMPLEMENTATIONS */
-
 void bail_out_parent(int eval, const char * fmt, ...){
 	DEBUG("bail out parent started\n");
 	free_parent_resources();
@@ -56,14 +153,8 @@ void parentProcess( void ){
 
 	DEBUG("starting parent process\n");
 
-	reading = fdopen(pipes[PARENT][READ], "r");
-	if (reading == NULL) {
-		bail_out_parent(EXIT_FAILURE,"parent failed reading pipe");
-	}
-	writing = fdopen(pipes[CHILD][WRITE], "w");
-	if (writing == NULL) {
-		bail_out_parent(EXIT_FAILURE,"parent failed writing pipe");
-	}
+	child_output = pipes[PARENT][READ];
+	child_input = pipes[CHILD][WRITE];
 
 	if(close(pipes[CHILD][READ]) != 0) {
 		bail_out_parent(EXIT_FAILURE,"close + 1 failed");
@@ -72,30 +163,97 @@ void parentProcess( void ){
 		bail_out_parent(EXIT_FAILURE,"close + 2 failed");
 	}
 
-	/* Get Input */
-	char input[INPUT_BUFFER_LENGTH + 2];
-	char result[RESULT_BUFFER_LENGTH + 1];	
+	/* only the pipes belong to this process, stdin and stdout stay blocking */
+	if(fcntl(child_input, F_SETFL, O_NONBLOCK) != 0
+		|| fcntl(child_output, F_SETFL, O_NONBLOCK) != 0){
+		bail_out_parent(EXIT_FAILURE,"fcntl of the pipes failed");
+	}
+
+	/* stdout may be a blocking pipe, PIPE_BUF bytes never block after POLLOUT */
+	struct stat stdout_info;
+	if(fstat(STDOUT_FILENO, &stdout_info) == 0 && !S_ISREG(stdout_info.st_mode)){
+		stdout_limit = PIPE_BUF;
+	}
+
+	/* a child that bailed out shows up as end of file, not as signal */
+	struct sigaction ignore;
+	(void) memset(&ignore, 0, sizeof(ignore));
+	ignore.sa_handler = SIG_IGN;
+	if(sigaction(SIGPIPE, &ignore, NULL) != 0){
+		bail_out_parent(EXIT_FAILURE,"sigaction failed");
+	}
+
+	bool stdin_eof = false;
+	bool child_eof = false;
+	char last_input = '\n';
 
-	while(fgets(input,INPUT_BUFFER_LENGTH + 2, stdin) != NULL){
-		DEBUG("parent received: %s\n",input);
-		if( fprintf(writing, "%s", input)<0){
-			bail_out_parent(EXIT_FAILURE,"writing to child via pipe failed");
+	while(!child_eof || to_stdout.end > to_stdout.start){
+		struct pollfd fds[4];
+		bool child_pending = to_child.end > to_child.start;
+		bool stdout_pending = to_stdout.end > to_stdout.start;
+
+		/* one byte of to_child stays free for the newline of an unterminated last line */
+		fds[0].fd = (!stdin_eof && queue_space(&to_child) > 1) ? STDIN_FILENO : -1;
+		fds[0].events = POLLIN;
+		fds[1].fd = child_pending ? child_input : -1;
+		fds[1].events = POLLOUT;
+		fds[2].fd = (!child_eof && queue_space(&to_stdout) > 0) ? child_output : -1;
+		fds[2].events = POLLIN;
+		fds[3].fd = stdout_pending ? STDOUT_FILENO : -1;
+		fds[3].events = POLLOUT;
+
+		if(poll(fds, 4, -1) < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			bail_out_parent(EXIT_FAILURE,"poll failed");
+		}
+
+		if(fds[0].revents != 0){
+			ssize_t received = fill_queue(STDIN_FILENO, &to_child, 1);
+			if(received < 0 && errno != EINTR){
+				bail_out_parent(EXIT_FAILURE,"reading from stdin failed");
+			}
+			if(received > 0){
+				DEBUG("parent received %ld bytes\n", (long) received);
+				last_input = to_child.data[to_child.end - 1];
+			}
+			if(received == 0){
+				stdin_eof = true;
+				if(last_input != '\n'){
+					to_child.data[to_child.end++] = '\n';
+				}
+			}
 		}
-		if( fflush(writing) != 0){
-			bail_out_parent(EXIT_FAILURE,"flushing the pipe to child failed");
+
+		if(fds[1].revents != 0 && drain_queue(child_input, &to_child, PARENT_QUEUE_SIZE) < 0){
+			/* the child is gone, its exit code is reported by free_parent_resources */
+			DEBUG("child does not accept input anymore\n");
+			to_child.start = to_child.end = 0;
+			stdin_eof = true;
+		}
+		if(stdin_eof && to_child.end == to_child.start && child_input >= 0){
+			DEBUG("all input sent to the child\n");
+			close_pipe(&child_input);
+		}
+
+		if(fds[2].revents != 0){
+			ssize_t received = fill_queue(child_output, &to_stdout, 0);
+			if(received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+				bail_out_parent(EXIT_FAILURE,"the reading of the result from the client got an error");
+			}
+			if(received == 0){
+				child_eof = true;
+			}
 		}
-		DEBUG("parent sent: %s to child\n",input);
 
-		if( fgets(result, RESULT_BUFFER_LENGTH, reading) != NULL){
-			DEBUG("parent received %s from child\n",result);
-			(void) fprintf(stdout, "%s", result);
-		} else{
-			bail_out_parent(EXIT_FAILURE,"the reading of the result from the client got an error");
+		if(fds[3].revents != 0 && drain_queue(STDOUT_FILENO, &to_stdout, stdout_limit) < 0){
+			bail_out_parent(EXIT_FAILURE,"writing to stdout failed");
 		}
 	}
 
-	if ( feof(stdin) == 0 ){
-		bail_out_parent(EXIT_FAILURE,"reading from stdin failed");
+	if(!stdin_eof || child_input >= 0){
+		bail_out_parent(EXIT_FAILURE,"the child closed its pipe before all input was calculated");
 	}
 
 	free_parent_resources();
@@ -15,25 +15,18 @@
 
 /* CONSTANTS */
 
-/* MACROS */
-
-/* GLOBAL VARIABLES */
-
 /**
-*@brief global variable for reading from the pipe from the child process
-*/
-FILE * reading;
+ * @brief The size of the queues between stdin, the child process and stdout
+ */
+#define PARENT_QUEUE_SIZE		(64 * 1024)
 
-/**
-*@brief global variable for writing to the pipe to the child process
-*/
-FILE * writing;
+/* MACROS */
 
 /* PROTOTYPES */
 
 /**
  * @brief free all resources from the parent and closes the child stream
- * @details closes pipes: global variables "writing" and "reading"
+ * @details closes the pipes to and from the child process and waits for it
  */
 void free_parent_resources( void );
 
@@ -44,7 +37,9 @@ void bail_out_parent(int eval, const char * fmt, ...);
 
 /**
  * @brief the main function of the parent process. this method is called from the main function of calculator 
- * @details global variable pipes the pipes for the communication between the child process and the parent process
+ * @details global variable pipes the pipes for the communication between the child process and the parent process.
+ * stdin, the pipes and stdout are multiplexed with poll, so input and results are forwarded independently
+ * through bounded queues of PARENT_QUEUE_SIZE bytes
  */
 void parentProcess( void );
 
@@ -0,0 +1,503 @@
+/**
+ * @file server.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This file contains the daemon mode of the calculator. It calculates the lines of many clients of a unix domain socket in one event loop
+ * @date 19.10.2026
+ */
+
+#include "calculator.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+/**
+ * @brief a growable byte buffer
+ */
+struct buffer {
+	/*! @brief the bytes of the buffer*/
+	char *data;
+	/*! @brief the number of used bytes*/
+	size_t length;
+	/*! @brief the allocated size of data*/
+	size_t capacity;
+};
+
+/**
+ * @brief the state of one client
+ */
+struct connection {
+	/*! @brief the socket of the client*/
+	int fd;
+	/*! @brief the received bytes that are not calculated yet*/
+	struct buffer input;
+	/*! @brief the results for the client*/
+	struct buffer output;
+	/*! @brief the number of bytes of output that are already sent*/
+	size_t sent;
+	/*! @brief the epoll events the socket is registered with*/
+	uint32_t events;
+	/*! @brief true if the client closed its side and the connection closes after the output is sent*/
+	bool closing;
+};
+
+/**
+ * @brief the listening socket
+ */
+static int listen_fd = -1;
+
+/**
+ * @brief the epoll instance of the event loop
+ */
+static int epoll_fd = -1;
+
+/**
+ * @brief the path of the socket that gets removed on shutdown
+ */
+static const char *socket_path;
+
+/**
+ * @brief set by the signal handler to stop the event loop
+ */
+static volatile sig_atomic_t quit = 0;
+
+/**
+ * @brief the signal mask of the event loop while it waits, SIGINT and SIGTERM are blocked outside of epoll_pwait
+ */
+static sigset_t wait_mask;
+
+/* STATIC FUNCTIONS */
+
+/**
+ * @brief stops the event loop
+ * @param sig signal number catched
+ */
+static void handle_signal(int sig){
+	quit = 1;
+}
+
+/**
+ * @brief free all resources of the daemon mode and removes the socket file
+ * @details global variables: listen_fd, epoll_fd, socket_path
+ */
+static void free_server_resources( void ){
+	DEBUG("Start closing daemon\n");
+	if(epoll_fd >= 0){
+		(void) close(epoll_fd);
+		epoll_fd = -1;
+	}
+	if(listen_fd >= 0){
+		(void) close(listen_fd);
+		listen_fd = -1;
+		if(unlink(socket_path) != 0){
+			int errcode = errno;
+			(void) fprintf(stderr, "%s: ", program_name);
+			(void) fprintf(stderr,"removing the socket error. Code: %s\n", strerror(errcode));
+		}
+	}
+	DEBUG("daemon closed\n");
+}
+
+/**
+ * @brief exits the daemon mode and closes all resources
+ * @param eval the exit code
+ * @param msg the message to print
+ */
+static void bail_out_server(int eval, const char *msg){
+	int errcode = errno;
+	free_server_resources();
+	errno = errcode;
+	bail_out(eval, "%s", msg);
+}
+
+/**
+ * @brief makes sure that a buffer has space for more bytes
+ * @param buffer the buffer
+ * @param space the number of bytes that must fit behind the used bytes
+ * @return 0 on success, -1 if no memory is left
+ */
+static int reserve(struct buffer *buffer, size_t space){
+	size_t capacity = buffer->capacity == 0 ? LINE_INITIAL_CAPACITY : buffer->capacity;
+	while(capacity - buffer->length < space){
+		capacity *= 2;
+	}
+	if(capacity == buffer->capacity){
+		return 0;
+	}
+	char *data = realloc(buffer->data, capacity);
+	if(data == NULL){
+		return -1;
+	}
+	buffer->data = data;
+	buffer->capacity = capacity;
+	return 0;
+}
+
+/**
+ * @brief closes the socket of a client and frees its state
+ * @param connection the client
+ */
+static void close_connection(struct connection *connection){
+	DEBUG("closing client %d\n", connection->fd);
+	(void) close(connection->fd);
+	free(connection->input.data);
+	free(connection->output.data);
+	free(connection);
+}
+
+/**
+ * @brief registers the socket of a client for the events it currently needs
+ * @details input is only read while the unsent output is below SERVER_OUTPUT_LIMIT
+ * @param connection the client
+ * @return 0 on success, -1 on error
+ */
+static int update_events(struct connection *connection){
+	size_t pending = connection->output.length - connection->sent;
+	uint32_t events = 0;
+
+	if(!connection->closing && pending < SERVER_OUTPUT_LIMIT){
+		events |= EPOLLIN;
+	}
+	if(pending > 0){
+		events |= EPOLLOUT;
+	}
+	if(events == connection->events){
+		return 0;
+	}
+
+	struct epoll_event event;
+	event.events = events;
+	event.data.ptr = connection;
+	if(epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection->fd, &event) != 0){
+		return -1;
+	}
+	connection->events = events;
+	return 0;
+}
+
+/**
+ * @brief calculates one line of a client and appends the answer to its output
+ * @param connection the client
+ * @param line the line without newline
+ * @param length the length of the line
+ * @return 0 on success, -1 if no memory is left
+ */
+static int calculate_line(struct connection *connection, const char *line, size_t length){
+	struct buffer *output = &connection->output;
+	const char *error;
+	long operand1;
+	long operand2;
+	operator op;
+
+	if(parse_expression(line, length, &operand1, &operand2, &op, &error) == 0){
+		if(reserve(output, RESULT_BUFFER_LENGTH) < 0){
+			return -1;
+		}
+		int result_length = calculate(operand1, operand2, op, output->data + output->length);
+		if(result_length >= 0){
+			output->length += result_length;
+			output->data[output->length++] = '\n';
+			return 0;
+		}
+		error = "division by zero";
+	}
+
+	size_t error_length = strlen(error);
+	if(reserve(output, error_length + sizeof("error: \n")) < 0){
+		return -1;
+	}
+	output->length += sprintf(output->data + output->length, "error: %s\n", error);
+	return 0;
+}
+
+/**
+ * @brief calculates all complete lines in the input of a client
+ * @param connection the client
+ * @return 0 on success, -1 if no memory is left
+ */
+static int calculate_input(struct connection *connection){
+	struct buffer *input = &connection->input;
+	char *line = input->data;
+	char *end = input->data + input->length;
+	char *newline;
+
+	while((newline = memchr(line, '\n', end - line)) != NULL){
+		if(calculate_line(connection, line, newline - line) < 0){
+			return -1;
+		}
+		line = newline + 1;
+	}
+
+	/* a line that does not end is answered with an error and ends the connection */
+	if(end - line > SERVER_LINE_LIMIT){
+		static const char message[] = "error: line too long\n";
+		if(reserve(&connection->output, sizeof(message) - 1) < 0){
+			return -1;
+		}
+		(void) memcpy(connection->output.data + connection->output.length, message, sizeof(message) - 1);
+		connection->output.length += sizeof(message) - 1;
+		connection->closing = true;
+		line = end;
+	}
+
+	/* the last line of a client does not need a newline */
+	if(connection->closing && line < end){
+		if(calculate_line(connection, line, end - line) < 0){
+			return -1;
+		}
+		line = end;
+	}
+
+	input->length = end - line;
+	(void) memmove(input->data, line, input->length);
+	return 0;
+}
+
+/**
+ * @brief sends as much of the output of a client as the socket accepts
+ * @param connection the client
+ * @return 0 on success, -1 if the connection is broken
+ */
+static int send_output(struct connection *connection){
+	struct buffer *output = &connection->output;
+
+	while(connection->sent < output->length){
+		ssize_t written = write(connection->fd, output->data + connection->sent,
+			output->length - connection->sent);
+		if(written < 0){
+			if(errno == EAGAIN || errno == EWOULDBLOCK){
+				return 0;
+			}
+			if(errno == EINTR){
+				continue;
+			}
+			return -1;
+		}
+		connection->sent += written;
+	}
+	output->length = 0;
+	connection->sent = 0;
+	return 0;
+}
+
+/**
+ * @brief reads the available input of a client and calculates its lines
+ * @param connection the client
+ * @return 0 on success, -1 if the connection is broken
+ */
+static int receive_input(struct connection *connection){
+	struct buffer *input = &connection->input;
+
+	if(reserve(input, SERVER_READ_SIZE) < 0){
+		return -1;
+	}
+	ssize_t received = read(connection->fd, input->data + input->length, SERVER_READ_SIZE);
+	if(received < 0){
+		return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+	}
+	if(received == 0){
+		connection->closing = true;
+	}
+	input->length += received;
+	return calculate_input(connection);
+}
+
+/**
+ * @brief handles the events of one client
+ * @param connection the client
+ * @param events the events of epoll
+ */
+static void handle_connection(struct connection *connection, uint32_t events){
+	/* EPOLLHUP and EPOLLERR are reported without EPOLLIN, too, a backed up client is not read */
+	if((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !connection->closing
+		&& connection->output.length - connection->sent < SERVER_OUTPUT_LIMIT){
+		if(receive_input(connection) < 0){
+			close_connection(connection);
+			return;
+		}
+	}
+	if(send_output(connection) < 0){
+		close_connection(connection);
+		return;
+	}
+	if(connection->closing && connection->output.length == 0){
+		close_connection(connection);
+		return;
+	}
+	if(update_events(connection) < 0){
+		close_connection(connection);
+	}
+}
+
+/**
+ * @brief accepts all pending clients and registers them at the event loop
+ * @details global variables: listen_fd, epoll_fd
+ */
+static void accept_clients( void ){
+	int fd;
+
+	while((fd = accept(listen_fd, NULL, NULL)) >= 0){
+		struct connection *connection = calloc(1, sizeof(*connection));
+		if(connection == NULL){
+			(void) close(fd);
+			continue;
+		}
+		connection->fd = fd;
+		connection->events = EPOLLIN;
+
+		struct epoll_event event;
+		event.events = connection->events;
+		event.data.ptr = connection;
+		if(fcntl(fd, F_SETFL, O_NONBLOCK) != 0
+			|| epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0){
+			close_connection(connection);
+			continue;
+		}
+		DEBUG("accepted client %d\n", fd);
+	}
+
+	if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && errno != ECONNABORTED){
+		bail_out_server(EXIT_FAILURE,"accepting a client failed");
+	}
+}
+
+/**
+ * @brief removes the socket file of a daemon that did not shut down
+ * @details the file is only removed if it is a socket that nobody listens on, a running daemon keeps its socket
+ * @param address the address of the socket
+ */
+static void remove_stale_socket(const struct sockaddr_un *address){
+	struct stat info;
+
+	if(lstat(address->sun_path, &info) != 0 || !S_ISSOCK(info.st_mode)){
+		return;
+	}
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0){
+		return;
+	}
+	if(connect(fd, (const struct sockaddr *) address, sizeof(*address)) != 0 && errno == ECONNREFUSED){
+		DEBUG("removing the stale socket %s\n", address->sun_path);
+		(void) unlink(address->sun_path);
+	}
+	(void) close(fd);
+}
+
+/**
+ * @brief creates the listening socket and the epoll instance
+ * @param path the path of the socket
+ * @details global variables: listen_fd, epoll_fd, socket_path
+ */
+static void init_server(const char *path){
+	struct sockaddr_un address;
+
+	if(strlen(path) >= sizeof(address.sun_path)){
+		errno = ENAMETOOLONG;
+		bail_out_server(EXIT_FAILURE,"the path of the socket is too long");
+	}
+	(void) memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	(void) strcpy(address.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0){
+		bail_out_server(EXIT_FAILURE,"creating the socket failed");
+	}
+	remove_stale_socket(&address);
+	if(bind(fd, (struct sockaddr *) &address, sizeof(address)) != 0){
+		(void) close(fd);
+		bail_out_server(EXIT_FAILURE,"binding the socket failed");
+	}
+	/* from here on the socket file gets removed on shutdown */
+	listen_fd = fd;
+	socket_path = path;
+
+	if(listen(listen_fd, SERVER_BACKLOG) != 0){
+		bail_out_server(EXIT_FAILURE,"listening on the socket failed");
+	}
+	if(fcntl(listen_fd, F_SETFL, O_NONBLOCK) != 0){
+		bail_out_server(EXIT_FAILURE,"fcntl of the socket failed");
+	}
+
+	epoll_fd = epoll_create(SERVER_MAX_EVENTS);
+	if(epoll_fd < 0){
+		bail_out_server(EXIT_FAILURE,"epoll_create failed");
+	}
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) != 0){
+		bail_out_server(EXIT_FAILURE,"epoll_ctl of the socket failed");
+	}
+}
+
+/**
+ * @brief stops the event loop on SIGINT and SIGTERM and ignores SIGPIPE of closed clients
+ * @details SIGINT and SIGTERM are blocked and only delivered inside of epoll_pwait, so none gets lost between the check of
+ * quit and the wait. global variables: wait_mask
+ */
+static void setup_server_signals( void ){
+	const int signals[] = { SIGINT, SIGTERM };
+	struct sigaction s;
+	sigset_t blocked;
+
+	(void) sigemptyset(&blocked);
+	for(int i = 0; i < sizeof(signals) / sizeof(signals[0]); ++i){
+		(void) sigaddset(&blocked, signals[i]);
+	}
+	if(sigprocmask(SIG_BLOCK, &blocked, &wait_mask) != 0){
+		bail_out_server(EXIT_FAILURE,"sigprocmask failed");
+	}
+	for(int i = 0; i < sizeof(signals) / sizeof(signals[0]); ++i){
+		(void) sigdelset(&wait_mask, signals[i]);
+	}
+
+	(void) memset(&s, 0, sizeof(s));
+	(void) sigfillset(&s.sa_mask);
+	s.sa_handler = handle_signal;
+	/* no SA_RESTART, epoll_pwait has to return */
+	for(int i = 0; i < sizeof(signals) / sizeof(signals[0]); ++i){
+		if(sigaction(signals[i], &s, NULL) != 0){
+			bail_out_server(EXIT_FAILURE,"sigaction failed");
+		}
+	}
+	s.sa_handler = SIG_IGN;
+	if(sigaction(SIGPIPE, &s, NULL) != 0){
+		bail_out_server(EXIT_FAILURE,"sigaction failed");
+	}
+}
+
+/* IMPLEMENTATIONS */
+
+void serverProcess( const char *path ){
+	struct epoll_event events[SERVER_MAX_EVENTS];
+
+	DEBUG("starting daemon on %s\n", path);
+
+	setup_server_signals();
+	init_server(path);
+
+	while(quit == 0){
+		int count = epoll_pwait(epoll_fd, events, SERVER_MAX_EVENTS, -1, &wait_mask);
+		if(count < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			bail_out_server(EXIT_FAILURE,"epoll_pwait failed");
+		}
+		for(int i = 0; i < count; ++i){
+			if(events[i].data.ptr == NULL){
+				accept_clients();
+			} else{
+				handle_connection(events[i].data.ptr, events[i].events);
+			}
+		}
+	}
+
+	/* the open clients are released by the exit of the process */
+	free_server_resources();
+}
@@ -0,0 +1,54 @@
+/**
+ * @file server.h
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This headerfile contains the Prototypes, Constants and Macros of "server.c"
+ * @date 19.10.2026
+ */
+
+/**
+ * prevent multible inclusion
+ */
+#ifndef dp_server_h
+#define dp_server_h
+
+#include "calculator.h"
+
+/* CONSTANTS */
+
+/**
+ * @brief The maximum number of events that are handled in one iteration of the event loop
+ */
+#define SERVER_MAX_EVENTS		(64)
+
+/**
+ * @brief The number of pending connections of the listening socket
+ */
+#define SERVER_BACKLOG			(128)
+
+/**
+ * @brief The number of bytes that are read from a client at once
+ */
+#define SERVER_READ_SIZE		(64 * 1024)
+
+/**
+ * @brief The number of unsent result bytes of a client at which no more input of it is read
+ */
+#define SERVER_OUTPUT_LIMIT		(1024 * 1024)
+
+/**
+ * @brief The longest line of a client, a client with a longer line gets an error and is disconnected
+ */
+#define SERVER_LINE_LIMIT		(64 * 1024)
+
+/* PROTOTYPES */
+
+/**
+ * @brief the main function of the daemon mode. this method is called from the main function of calculator
+ * @details listens on a unix domain socket and calculates the lines of all clients in one epoll event loop.
+ * Every line gets answered with its result or with "error: <description>". Runs until SIGINT or SIGTERM.
+ * A socket file that no daemon listens on is replaced
+ * @param path the path of the socket
+ */
+void serverProcess( const char *path );
+
+#endif /*ifndef dp_server_h*/
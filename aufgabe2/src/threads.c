@@ -0,0 +1,183 @@
+/**
+ * @file threads.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This file contains the threaded mode of the calculator. A reader and an evaluator thread replace the parent and the child process
+ * @date 19.10.2026
+ */
+
+#include "calculator.h"
+#include <stdbool.h>
+#include <pthread.h>
+
+/**
+ * @brief the lines that are read but not yet calculated
+ * @details slots from head to head + count - 1 belong to the evaluator, all others to the reader
+ */
+static struct line slots[THREADS_QUEUE_SIZE];
+
+/**
+ * @brief the index of the oldest line of the queue
+ */
+static size_t head = 0;
+
+/**
+ * @brief the number of lines in the queue
+ */
+static size_t count = 0;
+
+/**
+ * @brief true if the reader reached the end of stdin
+ */
+static bool done = false;
+
+/**
+ * @brief protects head, count and done
+ */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief signaled when the queue is not empty anymore or the reader is done
+ */
+static pthread_cond_t not_empty = PTHREAD_COND_INITIALIZER;
+
+/**
+ * @brief signaled when the queue is not full anymore
+ */
+static pthread_cond_t not_full = PTHREAD_COND_INITIALIZER;
+
+/* STATIC FUNCTIONS */
+
+/**
+ * @brief free the line buffers of the queue
+ * @details global variable: slots
+ */
+static void free_thread_resources( void ){
+	DEBUG("Start closing threaded mode\n");
+	for(int i = 0; i < THREADS_QUEUE_SIZE; ++i){
+		free_line(&slots[i]);
+	}
+	DEBUG("threaded mode closed\n");
+}
+
+/**
+ * @brief the evaluator stage: calculates the lines of the queue and prints the results
+ * @details stdout is only flushed when the queue runs empty, so bursts of lines cost one write
+ * @param argument unused
+ * @return NULL
+ */
+static void *evaluate_lines(void *argument){
+	char result[RESULT_BUFFER_LENGTH + 1];
+
+	for(;;){
+		(void) pthread_mutex_lock(&lock);
+		if(count == 0 && !done){
+			(void) pthread_mutex_unlock(&lock);
+			if(fflush(stdout) != 0){
+				bail_out(EXIT_FAILURE,"flushing stdout failed");
+			}
+			(void) pthread_mutex_lock(&lock);
+			while(count == 0 && !done){
+				(void) pthread_cond_wait(&not_empty, &lock);
+			}
+		}
+		if(count == 0){
+			(void) pthread_mutex_unlock(&lock);
+			break;
+		}
+		struct line *line = &slots[head];
+		(void) pthread_mutex_unlock(&lock);
+
+		const char *error;
+		long operand1;
+		long operand2;
+		operator op;
+
+		DEBUG("evaluator received: %s\n",line->data);
+		if(parse_expression(line->data, line->length, &operand1, &operand2, &op, &error) < 0){
+			usage();
+			bail_out(EXIT_FAILURE, "%s", error);
+		}
+		int length = calculate(operand1, operand2, op, result);
+		if(length < 0){
+			bail_out(EXIT_FAILURE,"division by zero");
+		}
+		result[length++] = '\n';
+		if(fwrite(result, 1, length, stdout) != length){
+			bail_out(EXIT_FAILURE,"writing to stdout failed");
+		}
+
+		(void) pthread_mutex_lock(&lock);
+		head = (head + 1) % THREADS_QUEUE_SIZE;
+		if(count-- == THREADS_QUEUE_SIZE){
+			(void) pthread_cond_signal(&not_full);
+		}
+		(void) pthread_mutex_unlock(&lock);
+	}
+
+	if(fflush(stdout) != 0){
+		bail_out(EXIT_FAILURE,"flushing stdout failed");
+	}
+	return NULL;
+}
+
+/**
+ * @brief the reader stage: reads the lines of stdin into the queue
+ * @details the line is read into a free slot without holding the lock
+ */
+static void read_lines( void ){
+	size_t tail = 0;
+
+	for(;;){
+		(void) pthread_mutex_lock(&lock);
+		while(count == THREADS_QUEUE_SIZE){
+			(void) pthread_cond_wait(&not_full, &lock);
+		}
+		(void) pthread_mutex_unlock(&lock);
+
+		bool eof = read_line(stdin, &slots[tail]) < 0;
+
+		(void) pthread_mutex_lock(&lock);
+		if(eof){
+			done = true;
+		} else{
+			tail = (tail + 1) % THREADS_QUEUE_SIZE;
+			++count;
+		}
+		if(eof || count == 1){
+			(void) pthread_cond_signal(&not_empty);
+		}
+		(void) pthread_mutex_unlock(&lock);
+
+		if(eof){
+			break;
+		}
+	}
+
+	if(feof(stdin) == 0){
+		bail_out(EXIT_FAILURE,"reading from stdin failed");
+	}
+}
+
+/* IMPLEMENTATIONS */
+
+void threadedProcess( void ){
+	pthread_t evaluator;
+
+	DEBUG("starting threaded mode\n");
+
+	int error = pthread_create(&evaluator, NULL, evaluate_lines, NULL);
+	if(error != 0){
+		errno = error;
+		bail_out(EXIT_FAILURE,"creating the evaluator thread failed");
+	}
+
+	read_lines();
+
+	error = pthread_join(evaluator, NULL);
+	if(error != 0){
+		errno = error;
+		bail_out(EXIT_FAILURE,"joining the evaluator thread failed");
+	}
+
+	free_thread_resources();
+}
@@ -0,0 +1,32 @@
+/**
+ * @file threads.h
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This headerfile contains the Prototypes, Constants and Macros of "threads.c"
+ * @date 19.10.2026
+ */
+
+/**
+ * prevent multible inclusion
+ */
+#ifndef dp_threads_h
+#define dp_threads_h
+
+#include "calculator.h"
+
+/* CONSTANTS */
+
+/**
+ * @brief The number of lines the queue between the reader and the evaluator thread can hold
+ */
+#define THREADS_QUEUE_SIZE		(1024)
+
+/* PROTOTYPES */
+
+/**
+ * @brief the main function of the threaded mode. this method is called from the main function of calculator
+ * @details the roles of the parent and the child process are taken by two threads of this process. The reader
+ * thread reads the lines of stdin into a bounded queue, the evaluator thread calculates them and prints the results
+ */
+void threadedProcess( void );
+
+#endif /*ifndef dp_threads_h*/
@@ -6,26 +6,57 @@
  */
 
 #include "shared.h"
+#include "solver.h"
 #include <stdbool.h>
 #include <limits.h>
 #include <assert.h>
 #include <math.h>
+#include <sys/mman.h>
+#include <termios.h>
+#include <ctype.h>
+
+/* === CONSTANTS === */
+
+/**
+ * @brief the size of the buffer of one frame, enough for a full frame of the largest board
+ */
+#define FRAME_SIZE			(4096)
+
+/**
+ * @brief the prompt for the next command
+ */
+#define PROMPT				"Enter Command: >"
+
+/**
+ * @brief the size of the buffer of the keys that are read at once on a raw terminal
+ */
+#define KEYS_SIZE			(64)
+
+/**
+ * @brief the escape byte that starts the sequences of the arrow keys
+ */
+#define KEY_ESCAPE			(0x1b)
+
+/**
+ * @brief the byte of Ctrl-D, it ends the input like EOF
+ */
+#define KEY_END				(0x04)
 
 /* === TYPE DEFINITIONS === */
 
 /* === GLOBALS === */
 
-extern int shm_id_game;
-extern int shm_id_clients;
-extern int sem_client;
-extern int sem_client2;
-extern int s1;
-extern int s2;
-extern int s3;
-extern int s4;
+/**
+ * @brief the shared memory of the server and the games, kept out of the globals of shared.c so free_resources of the client does not remove them
+ */
+static int shm_id_clients = -1;
 
 /**
- * @brief the pointer to the shared memory of a game
+ * @brief the pointer to the arena with the slots of all games
+ */
+static struct shared_arena *arena;
+/**
+ * @brief the pointer to the slot of the game in the arena
  */
 static struct shared_game* game;
 /**
@@ -38,9 +69,108 @@ static struct shared_server *server;
  */
 static uint16_t id;
 
+/**
+ * @brief true if the solver plays instead of the user
+ */
+static bool autoplay = false;
+
+/**
+ * @brief the number of tiles of a row of a new game
+ */
+static unsigned int width = FIELD_SIZE_X;
+
+/**
+ * @brief the number of rows of a new game
+ */
+static unsigned int height = FIELD_SIZE_Y;
+
+/**
+ * @brief true if only the changed tiles are redrawn with ANSI cursor movement
+ */
+static bool cursor_mode = false;
+
+/**
+ * @brief the frame that is composed, it is written with a single write
+ */
+static char frame[FRAME_SIZE];
+
+/**
+ * @brief the number of bytes in frame
+ */
+static size_t frame_length = 0;
+
+/**
+ * @brief the board on the terminal in cursor_mode
+ */
+static struct board shown;
+
+/**
+ * @brief the message on the terminal in cursor_mode, NULL if the next frame has to be drawn in full
+ */
+static const char *shown_msg = NULL;
+
+/**
+ * @brief true if the prompt is the last output, a frame on a raw terminal starts in a new line then
+ */
+static bool prompted = false;
+
+/**
+ * @brief true to read commands line by line even on a terminal
+ */
+static bool line_input = false;
+
+/**
+ * @brief true while the terminal is in non-canonical mode
+ */
+static bool raw_input = false;
+
+/**
+ * @brief the settings of the terminal before raw_input, they are restored at exit
+ */
+static struct termios saved_terminal;
+
+/**
+ * @brief the keys read from the raw terminal that are not handled yet
+ */
+static unsigned char keys[KEYS_SIZE];
+
+/**
+ * @brief the number of bytes in keys
+ */
+static size_t keys_length = 0;
+
+extern void (*free_games)(void);
+
+/**
+ * @brief true while send_commands writes the ring and schedules the game, a signal is handled after it
+ */
+static volatile sig_atomic_t sending = 0;
+
+/**
+ * @brief the signal that came while sending, 0 if none
+ */
+static volatile sig_atomic_t pending_signal = 0;
 
 /* === PROTOTYPES === */
 
+/**
+ * @brief the signal handler of the client, it puts off a signal that interrupts send_commands
+ * @param sig the signal
+ * @details sending, pending_signal
+ */
+static void catch_signal( int sig );
+
+/**
+ * @brief handles SIGINT, SIGQUIT, SIGTERM and SIGPIPE with catch_signal
+ */
+static void setup_client_signals( void );
+
+/**
+ * @brief pauses the game when the client is terminated, so it can be resumed like after EOF
+ * @details called by free_resources, game, server, id
+ */
+static void leave_game( void );
+
 /**
  * @brief initialize shared memory of server
  * @details shm_id_clients, server
@@ -48,9 +178,9 @@ static uint16_t id;
 static void init_shared_memory( void );
 
 /**
- * @brief initialize shared memory of the game and initializes the semaphores
- * @param key the key of the shared memory
- * @details shm_id_game, game, id
+ * @brief maps the arena file of the server and finds the slot of the game
+ * @param key the id of the game
+ * @details arena, game, id, server
  */
 static void init_shared_game( key_t key );
 
@@ -61,11 +191,18 @@ static void init_shared_game( key_t key );
  */
 static void usage(void);
 
+/**
+ * @brief parses the size of a new game
+ * @param arg the size as WIDTHxHEIGHT or one number for a square board
+ * @details global variables width and height get set
+ */
+static void parse_size(char *arg);
+
 /**
  * @brief Parse command line options
  * @param argc The argument counter
  * @param argv The argument vector
- * @details global variable id gets set
+ * @details global variables id, autoplay, cursor_mode, line_input, width and height get set
  */
 static void parse_args(int argc, char **argv);
 
@@ -75,12 +212,94 @@ static void parse_args(int argc, char **argv);
  */
 static int read_next_command( void );
 
+/**
+ * @brief reads the commands of one line, so a script can send many moves at once
+ * @param cmds the commands
+ * @param max the maximum number of commands, the rest of a longer line is read by the next call
+ * @returns the number of commands, EOF if stdin is at the end
+ */
+static int read_commands( int *cmds, int max );
+
+/**
+ * @brief switches a terminal on stdin to non-canonical input without echo, so every key is read at once
+ * @details raw_input, saved_terminal
+ */
+static void enable_raw_input( void );
+
+/**
+ * @brief restores the settings of the terminal, registered with atexit
+ * @details raw_input, saved_terminal
+ */
+static void restore_terminal( void );
+
+/**
+ * @brief reads the keys typed on a raw terminal, the keys typed since the last call are one batch
+ * @details w, a, s, d and the arrow keys move, e pauses, x deletes, h shows the help and other keys are ignored
+ * @param cmds the commands
+ * @param max the maximum number of commands, the rest is kept for the next call
+ * @returns the number of commands, EOF at the end of the input or on Ctrl-D
+ * @details keys, keys_length
+ */
+static int read_keys( int *cmds, int max );
+
+/**
+ * @brief writes commands into the command ring of the game and puts the game into the ready queue of the server if it is not scheduled yet
+ * @param cmds the commands
+ * @param count the number of commands {1,...,GAME_RING_SIZE - 1}
+ * @details game, server
+ */
+static void send_commands( const int *cmds, int count );
+
+/**
+ * @brief asks the solver for the next command
+ * @returns the best move of the field of the game, CMD_DELETE if no tile can move
+ */
+static int solve_next_command( void );
+
+/**
+ * @brief waits for the next status of the game
+ * @returns the status
+ */
+static unsigned int receive_status( void );
+
+/**
+ * @brief appends formatted text to the frame, text that does not fit is cut
+ * @param fmt the format string
+ * @details frame, frame_length
+ */
+static void frame_append(const char *fmt, ...);
+
+/**
+ * @brief writes the frame to stdout with a single write and empties it
+ * @details frame, frame_length
+ */
+static void frame_flush(void);
+
+/**
+ * @brief appends the whole field and its frame to the frame
+ * @param field the field
+ * @param msg the message of the game status
+ * @param size the width of the frame
+ */
+static void frame_full_field(const struct board *field, const char *msg, int size);
+
+/**
+ * @brief appends the tiles that differ from the shown board and the message to the frame, with ANSI cursor positions
+ * @param field the field
+ * @param msg the message of the game status
+ * @param size the width of the frame
+ * @details shown, shown_msg
+ */
+static void frame_changes(const struct board *field, const char *msg, int size);
+
 /**
  * @brief prints the field of the game with a message of the game status
+ * @details the frame is written with one write. In cursor_mode only the changes to the last frame are written
  * @param field the field to be printed
  * @param msg the message of the game status
+ * @param prompt true to ask for the next command after the field
  */
-static void print_field(struct tile field[FIELD_SIZE_Y][FIELD_SIZE_X], const char* msg);
+static void print_field(const struct board *field, const char* msg, bool prompt);
 
 /**
  * @brief prints a help message for the commands of the client
@@ -94,18 +313,58 @@ static void print_help(void);
 static void pause_game(void);
 
 /**
- * @brief deletes the game and closes the client
- * @details detaches the shared memory of the game and the server
+ * @brief closes the client after the game is finished
+ * @details puts the slot of the game back into the free list of the arena
  */
 static void clean_client_close(void);
 
 /* === IMPLEMENTATIONS === */
 
+static void catch_signal( int sig )
+{
+	//a half scheduled game would never see the CMD_DISCONNECT of leave_game
+	if(sending){
+		pending_signal = sig;
+		return;
+	}
+	(void) signal_handler(sig);
+}
+
+static void setup_client_signals( void )
+{
+	//a reader of the output that is gone (| head) must not kill the client with the game still on
+	const int signals[] = { SIGINT, SIGQUIT, SIGTERM, SIGPIPE };
+	struct sigaction s;
+
+	memset(&s, 0, sizeof(s));
+	s.sa_handler = catch_signal;
+	(void) sigfillset(&s.sa_mask);
+	s.sa_flags = SA_RESTART;
+	for(int i = 0; i < COUNT_OF(signals); i++) {
+		if (sigaction(signals[i], &s, NULL) < 0) {
+			(void) bail_out(EXIT_FAILURE, "sigaction");
+		}
+	}
+}
+
+static void leave_game( void )
+{
+	//the client has less than GAME_RING_SIZE commands in flight, so there is room for one more
+	if(game != NULL){
+		ring_push(&game->commands, CMD_DISCONNECT);
+		schedule_game(server, game, id);
+	}
+}
+
 
 static void usage(void)
 {
-	bail_out(EXIT_FAILURE, "USAGE: 2048-client [-n | -i <id>]\n"
+	bail_out(EXIT_FAILURE, "USAGE: 2048-client [-a] [-c] [-l] [-n [-s size] | -i <id>]\n"
+	"\t-a:\tLet the solver play the game, only on 4x4 boards\n"
+	"\t-c:\tRedraw only the tiles that changed (needs an ANSI terminal)\n"
+	"\t-l:\tRead the commands line by line, also on a terminal\n"
 	"\t-n:\tStart a new game\n"
+	"\t-s:\tSize of the new game as WIDTHxHEIGHT or WIDTH, from 3 up to 8 (default: 4x4)\n"
 	"\t-i:\tConnect to existing game with the given id\n");
 }
 
@@ -113,18 +372,13 @@ static void init_shared_game( key_t key )
 {
 	id = key;
 	DEBUG("Connect to shared game with key %d\n",key);
-	shm_id_game = shmget(SHM_KEY+key, sizeof(struct shared_game), PERMISSION);
-	if (shm_id_game < 0) {
-		(void) bail_out(EXIT_FAILURE,"Could not access the shared memory! Is there a online server?");
+	arena = map_arena(server->arena_path, false);
+	if (arena == NULL) {
+		(void) bail_out(EXIT_FAILURE,"can't map arena file %s", server->arena_path);
 	}
-	game = shmat(shm_id_game, NULL, 0);
-	if (game == (struct shared_game *) -1) {
-		(void) bail_out(EXIT_FAILURE,"shmat failed (game)");
-	}
-
-	(void) grab_semaphors(key);
+	game = &arena->games[key];
 
-	print_field(game->field,"NEW GAME");
+	print_field(&game->field,"NEW GAME",true);
 }
 
 
@@ -138,15 +392,18 @@ static void init_shared_memory( void )
 	if (server == (struct shared_server*) -1) {
 		(void) bail_out(EXIT_FAILURE,"shmat failed (server)");
 	}
+}
 
-	sem_client =semgrab(SEM_KEY);
-	if (sem_client < 0) {
-		(void) bail_out(EXIT_FAILURE,"semgrab (sem_client) failed");
+static void parse_size(char *arg)
+{
+	char *separator = strchr(arg, 'x');
+	if(separator != NULL){
+		*separator = '\0';
+		height = parse_number(separator + 1, "height", FIELD_SIZE_MIN, FIELD_SIZE_MAX);
 	}
-
-	sem_client2 =semgrab(SEM_KEY+1);
-	if (sem_client2 < 0) {
-		(void) bail_out(EXIT_FAILURE,"semgrab (sem_client2) failed");
+	width = parse_number(arg, "width", FIELD_SIZE_MIN, FIELD_SIZE_MAX);
+	if(separator == NULL){
+		height = width;
 	}
 }
 
@@ -157,6 +414,7 @@ static void parse_args(int argc, char **argv)
 	long id_arg = 0;
 	int nflag = 0;
 	int iflag = 0;
+	int sflag = 0;
 
 	id = ID_UNSET;
 
@@ -164,14 +422,39 @@ static void parse_args(int argc, char **argv)
 		program_name = argv[0];
 	}
 	
-	while ((getopt_result = getopt(argc, argv, "ni:")) != -1) {
+	while ((getopt_result = getopt(argc, argv, "aclns:i:")) != -1) {
 		switch (getopt_result) {
+		case 'a':
+			if(autoplay){
+				(void) usage();
+			}
+			autoplay = true;
+			break;
+		case 'c':
+			if(cursor_mode){
+				(void) usage();
+			}
+			cursor_mode = true;
+			break;
+		case 'l':
+			if(line_input){
+				(void) usage();
+			}
+			line_input = true;
+			break;
 		case 'n':
 			if(nflag != 0 || iflag != 0){
 				(void) usage();
 			}
 			nflag = 1;
 			break;
+		case 's':
+			if(sflag != 0){
+				(void) usage();
+			}
+			sflag = 1;
+			(void) parse_size(optarg);
+			break;
 		case 'i':
 	   		if(nflag != 0 || iflag != 0){
 				(void) usage();
@@ -204,11 +487,14 @@ static void parse_args(int argc, char **argv)
 		}
 	}
 
-	if(optind < argc){
+	if(optind < argc || (sflag != 0 && iflag != 0)){
 		(void) usage();
 	}
+	if(autoplay && (width != FIELD_SIZE_X || height != FIELD_SIZE_Y)){
+		bail_out(EXIT_FAILURE, "The solver only plays %dx%d games", FIELD_SIZE_X, FIELD_SIZE_Y);
+	}
 
-	DEBUG("Parsing Arguments finished.User ID: %d\n",id);
+	DEBUG("Parsing Arguments finished.User ID: %d Size: %ux%u\n",id,width,height);
 }
 
 
@@ -242,40 +528,301 @@ static int read_next_command( void )
 	assert(0);
 }
 
-static void print_field(struct tile field[FIELD_SIZE_Y][FIELD_SIZE_X], const char* msg)
+static int read_commands( int *cmds, int max )
 {
-	const int size = FIELD_SIZE_Y*5 + 5;
+	int count = 0;
+	int cmd;
+
+	if(raw_input){
+		return read_keys(cmds, max);
+	}
+
+	while(count < max && (cmd = read_next_command()) != '\n'){
+		if(cmd == EOF){
+			return count == 0 ? EOF : count;
+		}
+		cmds[count++] = cmd;
+	}
+	return count;
+}
+
+static void enable_raw_input( void )
+{
+	struct termios raw;
+
+	if(!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved_terminal) < 0){
+		return;
+	}
+	if(atexit(restore_terminal) != 0){
+		(void) bail_out(EXIT_FAILURE,"atexit");
+	}
+	raw = saved_terminal;
+	//signals like Ctrl-C stay on
+	raw.c_lflag &= ~(ICANON | ECHO);
+	raw.c_cc[VMIN] = 1;
+	raw.c_cc[VTIME] = 0;
+	if(tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw) < 0){
+		(void) bail_out(EXIT_FAILURE,"tcsetattr");
+	}
+	raw_input = true;
+}
+
+static void restore_terminal( void )
+{
+	if(raw_input){
+		(void) tcsetattr(STDIN_FILENO, TCSAFLUSH, &saved_terminal);
+		raw_input = false;
+	}
+}
+
+static int read_keys( int *cmds, int max )
+{
+	int count = 0;
+
+	for(;;){
+		size_t used = 0;
+		while(count < max && used < keys_length){
+			unsigned char key = keys[used];
+			if(key == KEY_ESCAPE){
+				//an arrow key is ESC [ A-D, or ESC O A-D in the application mode of the terminal
+				if(used + 1 < keys_length && keys[used + 1] != '[' && keys[used + 1] != 'O'){
+					++used;
+					continue;
+				}
+				if(used + 2 >= keys_length){
+					//the rest of the sequence comes with the next read
+					break;
+				}
+				switch(keys[used + 2]){
+					case 'A':
+						cmds[count++] = CMD_UP;
+						break;
+					case 'B':
+						cmds[count++] = CMD_DOWN;
+						break;
+					case 'C':
+						cmds[count++] = CMD_RIGHT;
+						break;
+					case 'D':
+						cmds[count++] = CMD_LEFT;
+						break;
+					default:
+						break;
+				}
+				used += 3;
+				continue;
+			}
+			if(key == KEY_END){
+				if(count == 0){
+					keys_length = 0;
+					return EOF;
+				}
+				break;
+			}
+			++used;
+			switch(tolower(key)){
+				case 'w':
+					cmds[count++] = CMD_UP;
+					break;
+				case 'a':
+					cmds[count++] = CMD_LEFT;
+					break;
+				case 's':
+					cmds[count++] = CMD_DOWN;
+					break;
+				case 'd':
+					cmds[count++] = CMD_RIGHT;
+					break;
+				case 'e':
+					cmds[count++] = CMD_DISCONNECT;
+					break;
+				case 'x':
+					cmds[count++] = CMD_DELETE;
+					break;
+				case 'h':
+					print_help();
+					break;
+				default:
+					break;
+			}
+		}
+		keys_length -= used;
+		memmove(keys, keys + used, keys_length);
+		if(count > 0){
+			return count;
+		}
+
+		//blocks until a key is typed and takes all keys typed since the last read
+		ssize_t result = read(STDIN_FILENO, keys + keys_length, sizeof(keys) - keys_length);
+		if(result == 0){
+			return EOF;
+		}
+		if(result < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			(void) bail_out(EXIT_FAILURE,"read of the keys");
+		}
+		keys_length += result;
+	}
+}
+
+static void send_commands( const int *cmds, int count )
+{
+	sending = 1;
+	for(int i = 0; i < count; ++i){
+		ring_push(&game->commands, cmds[i]);
+		DEBUG("Wrote command '%d' to server\n",cmds[i]);
+	}
+	schedule_game(server, game, id);
+	sending = 0;
+	if(pending_signal != 0){
+		(void) signal_handler(pending_signal);
+	}
+}
+
+static unsigned int receive_status( void )
+{
+	int status;
+
+	shared_sem_wait(&game->status_posted);
+	status = ring_pop(&game->statuses);
+	assert(status >= 0);
+	return status;
+}
+
+static int solve_next_command( void )
+{
+	if(game->field.width != FIELD_SIZE_X || game->field.height != FIELD_SIZE_Y){
+		bail_out(EXIT_FAILURE, "The solver only plays %dx%d games", FIELD_SIZE_X, FIELD_SIZE_Y);
+	}
+	int cmd = best_move(board_to_bitboard(&game->field), SOLVER_DEFAULT_DEPTH);
+	if(cmd < 0){
+		return CMD_DELETE;
+	}
+	putchar("adws"[cmd]);
+	putchar('\n');
+	return cmd;
+}
+
+static void frame_append(const char *fmt, ...)
+{
+	va_list ap;
+	size_t left = sizeof(frame) - frame_length;
+
+	va_start(ap, fmt);
+	int length = vsnprintf(frame + frame_length, left, fmt, ap);
+	va_end(ap);
+	if(length > 0){
+		frame_length += (size_t) length < left ? (size_t) length : left - 1;
+	}
+}
+
+static void frame_flush(void)
+{
+	size_t written = 0;
+
+	//text of stdio like the moves of the solver comes first
+	(void) fflush(stdout);
+	while(written < frame_length){
+		ssize_t result = write(STDOUT_FILENO, frame + written, frame_length - written);
+		if(result < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			(void) bail_out(EXIT_FAILURE,"write of the frame");
+		}
+		written += result;
+	}
+	frame_length = 0;
+}
+
+static void frame_full_field(const struct board *field, const char *msg, int size)
+{
+	//boards smaller than the default keep the frame of the default
+	const int padding = size - field->width*5 - 5;
 	char startline[size+1];
 	memset(startline,'#',size+1);
 	startline[size] = '\0';
 
-	char line[FIELD_SIZE_Y*5+1];
-	memset(line,'-',FIELD_SIZE_Y*5+1);
-	for(int i = 0; i < FIELD_SIZE_Y; ++i){
+	char line[FIELD_SIZE_MAX*5+1];
+	memset(line,'-',field->width*5+1);
+	for(int i = 0; i < field->width; ++i){
 		line[i*5] = '+';
 	}
-	line[FIELD_SIZE_Y*5] = '\0';
-	printf("%s\n",startline);
-	printf("#%-*s#\n",size-2," Tiles");
-	printf("# ID=%06d %*s#\n",id,size-13," ");
-	printf("#%*s#\n",size-2," ");
-	printf("# %-*s#\n",size-3,msg);
-	printf("#%*s#\n",size-2," ");
-
-	printf("# %s+ #\n# ",line);
-	for(int y = 0; y < FIELD_SIZE_Y; ++y){
-		for(int x = 0; x < FIELD_SIZE_X; ++x){
-			if(field[y][x].val == 0){
-				printf("|%4s","");
+	line[field->width*5] = '\0';
+	frame_append("%s\n",startline);
+	frame_append("#%-*s#\n",size-2," Tiles");
+	frame_append("# ID=%06d %*s#\n",id,size-13," ");
+	frame_append("#%*s#\n",size-2," ");
+	frame_append("# %-*s#\n",size-3,msg);
+	frame_append("#%*s#\n",size-2," ");
+
+	frame_append("# %s+%*s #\n# ",line,padding,"");
+	for(int y = 0; y < field->height; ++y){
+		for(int x = 0; x < field->width; ++x){
+			if(FIELD_TILE(*field,x,y) == 0){
+				frame_append("|%4s","");
+			} else{
+				frame_append("|%4u", 1<<FIELD_TILE(*field,x,y));
+			}
+		}
+		frame_append("|%*s #\n# %s+%*s #\n# ",padding,"",line,padding,"");
+	}
+	frame_append("%*s#\n",size-3," ");
+	frame_append("#%-*s#\n",size-2," Display help with 'h'");
+	frame_append("%s\n",startline);
+}
+
+static void frame_changes(const struct board *field, const char *msg, int size)
+{
+	//the message is in row 5 and the tiles (x,y) start in row 8+2y and column 4+5x of the full frame
+	if(strcmp(msg, shown_msg) != 0){
+		frame_append("\033[5;3H%-*s",size-3,msg);
+	}
+	for(int y = 0; y < field->height; ++y){
+		for(int x = 0; x < field->width; ++x){
+			if(FIELD_TILE(*field,x,y) == FIELD_TILE(shown,x,y)){
+				continue;
+			}
+			frame_append("\033[%d;%dH",8+2*y,4+5*x);
+			if(FIELD_TILE(*field,x,y) == 0){
+				frame_append("%4s","");
 			} else{
-				printf("|%4u", 1<<field[y][x].val);
+				frame_append("%4u", 1<<FIELD_TILE(*field,x,y));
 			}
 		}
-		printf("| #\n# %s+ #\n# ",line);
 	}
-	printf("%*s#\n",size-3," ");
-	printf("#%-*s#\n",size-2," Display help with 'h'");
-	printf("%s\n",startline);
+}
+
+static void print_field(const struct board *field, const char* msg, bool prompt)
+{
+	const int size = (field->width > FIELD_SIZE_X ? field->width : FIELD_SIZE_X)*5 + 5;
+
+	//a raw terminal does not echo the newline after the command
+	if(raw_input && prompted && !(cursor_mode && shown_msg != NULL)){
+		frame_append("\n");
+	}
+
+	if(cursor_mode && shown_msg != NULL){
+		(void) frame_changes(field, msg, size);
+		//the prompt row, the echo of the last command is cleared with it
+		frame_append("\033[%d;1H\033[K",2*field->height+11);
+	} else{
+		if(cursor_mode){
+			frame_append("\033[H\033[2J");
+		}
+		(void) frame_full_field(field, msg, size);
+	}
+	if(cursor_mode){
+		shown = *field;
+		shown_msg = msg;
+	}
+	if(prompt){
+		frame_append(PROMPT);
+	}
+	prompted = prompt;
+	(void) frame_flush();
 }
 
 static void print_help(void)
@@ -285,16 +832,26 @@ static void print_help(void)
 	memset(startline,'#',size+1);
 	startline[size] = '\0';
 
-	printf("%s\n",startline);
-	printf("#%-*s#\n",size-2," W = Up");
-	printf("#%-*s#\n",size-2," A = Left");
-	printf("#%-*s#\n",size-2," S = Down");
-	printf("#%-*s#\n",size-2," D = Right");
-	printf("#%-*s#\n",size-2," E = Pause game");
-	printf("#%-*s#\n",size-2," X = Delete game");
-	printf("#%-*s#\n",size-2," H = This Help");
-	printf("%s\n",startline);
-	printf("Enter Command: >");
+	if(raw_input && prompted){
+		frame_append("\n");
+	}
+	frame_append("%s\n",startline);
+	frame_append("#%-*s#\n",size-2," W = Up");
+	frame_append("#%-*s#\n",size-2," A = Left");
+	frame_append("#%-*s#\n",size-2," S = Down");
+	frame_append("#%-*s#\n",size-2," D = Right");
+	frame_append("#%-*s#\n",size-2," E = Pause game");
+	frame_append("#%-*s#\n",size-2," X = Delete game");
+	frame_append("#%-*s#\n",size-2," H = This Help");
+	if(raw_input){
+		frame_append("#%-*s#\n",size-2," Arrow keys move too");
+	}
+	frame_append("%s\n",startline);
+	frame_append(PROMPT);
+	prompted = true;
+	(void) frame_flush();
+	//the help moved the field, the next one is drawn in full
+	shown_msg = NULL;
 }
 
 static void pause_game(void)
@@ -302,18 +859,19 @@ static void pause_game(void)
 
 	DEBUG("%s: Clean Pause Client\n",program_name);
 
+	//the game can be resumed as soon as the worker published GAME_PAUSED
+	(void) final_state(game);
+
 	// Remove shm game
 	if (shmdt(server) < 0) {
 		(void) bail_out(EXIT_FAILURE,"Error detaching shared memory of server (shmdt)");
 	}
 
-	// Remove shm game
-	if (shmdt(game) < 0) {
-		(void) bail_out(EXIT_FAILURE,"Error detaching shared memory of game (shmdt)");
+	// Unmap arena
+	if (munmap(arena, sizeof(struct shared_arena)) < 0) {
+		(void) bail_out(EXIT_FAILURE,"Error unmapping arena file (munmap)");
 	}
 
-	MY_V(s4,"s4");
-
 	exit(EXIT_SUCCESS);
 }
 
@@ -322,7 +880,7 @@ static void clean_client_close(void)
 
 	DEBUG("Clean Client Close %s\n",program_name);
 
-	MY_V(s4,"s4");
+	(void) free_game(arena, id);
 
 	exit(EXIT_SUCCESS);
 }
@@ -333,63 +891,81 @@ static void clean_client_close(void)
  * @param argc The argument counter
  * @param argv The argument vector
  * @return EXIT_SUCCESS on success, EXIT_FAILURE in case of an error
- * @details global variables: program_name, id, server, game, s1, s2, s3, s4, sem_client, sem_client2
+ * @details global variables: program_name, id, server, game
 */
 int main(int argc, char ** argv) {
 	(void) parse_args(argc, argv);
-	(void) setup_signal_handler();	
+	(void) setup_client_signals();
+	free_games = leave_game;
 	(void) init_shared_memory();
+	if(autoplay && init_solver() < 0){
+		(void) bail_out(EXIT_FAILURE,"init_solver");
+	}
+	if(!autoplay && !line_input){
+		(void) enable_raw_input();
+	}
 	
-	server->id = id;
-	MY_V(sem_client,"sem_client");
 	DEBUG("WAIT FOR SERVER TO INIT GAME\n");
-	MY_P(sem_client2,"sem_client2");
- 	init_shared_game(server->id);
- 	printf("Enter Command: >");
-	int cmd;
-	while((cmd = read_next_command()) != EOF){
-		if(cmd == '\n') continue;
+	id = register_game(server, id, width, height);
+	if(id == ID_UNSET){
+		(void) bail_out(EXIT_FAILURE,"The server could not open the game");
+	}
+ 	init_shared_game(id);
+	int cmds[GAME_RING_SIZE - 1];
+	int count;
+	for(;;){
+		if(autoplay){
+			cmds[0] = solve_next_command();
+			count = 1;
+		} else if((count = read_commands(cmds, COUNT_OF(cmds))) == EOF){
+			break;
+		}
+		if(count == 0) continue;
 		if (ferror(stdin)) {
 			(void) bail_out(EXIT_FAILURE,"fgetc");
 		}
-		MY_P(s2,"s2");
-			game->command = cmd;
-			DEBUG("Wrote command '%d' to server\n",cmd);	
-		MY_V(s1,"s1");
-		MY_P(s3,"s3");
-			unsigned int status = game->status;
+		(void) send_commands(cmds, count);
+		for(int i = 0; i < count; ++i){
+			unsigned int status = receive_status();
 			DEBUG("STATUS: %d\n",status);
+			//only the last status of a line and final ones are shown
+			if(i < count - 1 && (status == ST_ON || status == ST_NOSUCHGAME)){
+				continue;
+			}
 			switch(status){
 			case ST_WON:
-				print_field(game->field,"GAME WON");
+				print_field(&game->field,"GAME WON",false);
 				(void) clean_client_close();
 				break;
 			case ST_LOST:
-				print_field(game->field,"GAME OVER");
+				print_field(&game->field,"GAME OVER",false);
 				(void) clean_client_close();
 				break;
 			case ST_ON:
-				print_field(game->field,"TILES MOVED");
+				print_field(&game->field,"TILES MOVED",true);
 				break;
 			case ST_DELETE:
-				print_field(game->field,"GAME DELETED");
+				print_field(&game->field,"GAME DELETED",false);
 				(void) clean_client_close();
 				break;
 			case ST_HALT:
-				print_field(game->field,"GAME PAUSED");
+				print_field(&game->field,"GAME PAUSED",false);
 				(void) pause_game();
 				break;
 			case ST_NOSUCHGAME:
-				print_field(game->field,"NO MOVE AVAILABLE");
+				print_field(&game->field,"NO MOVE AVAILABLE",true);
 				break;
 			default:
-				print_field(game->field,"UNKNOWN GAME STATUS");
+				print_field(&game->field,"UNKNOWN GAME STATUS",false);
 				(void) clean_client_close();
 				break;
+			}
 		}
-		printf("Enter Command: >");
-		MY_V(s4,"s4");
 	}
 
-	(void) clean_client_close(); 
+	//keep the game for later
+	cmds[0] = CMD_DISCONNECT;
+	(void) send_commands(cmds, 1);
+	(void) receive_status();
+	(void) pause_game();
 }
\ No newline at end of file
@@ -0,0 +1,812 @@
+/**
+ * @file 2048-gateway.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief The TCP gateway of a 2048 server. It plays the games of remote clients on the 2048-server of this host
+ * @details one thread serves all connections with an epoll event loop. For the server every connection is a client:
+ * the gateway registers its game and writes its commands into the rings of the game. It can not sleep on the futex of
+ * a game, so the connections that wait for the server are polled, first in a busy loop and then every millisecond.
+ * Idle connections cost no time. The protocol is described with GATEWAY_HELLO_SIZE and GATEWAY_FRAME_HEADER
+ * @date 19.10.2026
+ */
+
+#include "shared.h"
+#include <stdbool.h>
+#include <limits.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/* === CONSTANTS === */
+
+/**
+ * @brief the number of events taken with one epoll_wait
+ */
+#define EVENTS_SIZE			(256)
+
+/**
+ * @brief the number of commands a connection has in flight at most. One less than a client, so a CMD_DISCONNECT for a
+ * closed connection always fits into the ring
+ */
+#define GATEWAY_IN_FLIGHT	(GAME_RING_SIZE - 2)
+
+/**
+ * @brief the size of the largest frame
+ */
+#define FRAME_SIZE_MAX		(GATEWAY_FRAME_HEADER + FIELD_SIZE_MAX * FIELD_SIZE_MAX)
+
+/**
+ * @brief the size of the output buffer of a connection, the frames of all commands in flight fit into it
+ */
+#define OUTPUT_SIZE			(GAME_RING_SIZE * FRAME_SIZE_MAX)
+
+/**
+ * @brief the connection sends its hello
+ */
+#define CONN_HELLO			(0)
+/**
+ * @brief the server has not answered the registration of the connection yet
+ */
+#define CONN_REGISTERING	(1)
+/**
+ * @brief the game of the connection is on
+ */
+#define CONN_PLAYING		(2)
+/**
+ * @brief the game of the connection is over or paused, the connection is closed when the last frame is sent
+ */
+#define CONN_FINISHED		(3)
+
+/* === TYPE DEFINITIONS === */
+
+/**
+ * @brief a TCP connection and its game
+ */
+struct connection
+{
+	/**
+	 * @brief the socket, -1 after the remote client is gone
+	 */
+	int fd;
+	/**
+	 * @brief CONN_HELLO, CONN_REGISTERING, CONN_PLAYING or CONN_FINISHED
+	 */
+	int state;
+	/**
+	 * @brief the events the socket is registered for with epoll
+	 */
+	uint32_t events;
+	/**
+	 * @brief the hello of the remote client
+	 */
+	uint8_t hello[GATEWAY_HELLO_SIZE];
+	/**
+	 * @brief the number of bytes in hello
+	 */
+	size_t hello_length;
+	/**
+	 * @brief the registration slot while the server has not answered, NULL if no slot was free yet
+	 */
+	struct registration *request;
+	/**
+	 * @brief the id of the game, ID_UNSET before the registration
+	 */
+	uint16_t id;
+	/**
+	 * @brief the slot of the game in the arena
+	 */
+	struct shared_game *game;
+	/**
+	 * @brief true after the remote client shut down its sending side, the game is paused when its frames are sent
+	 */
+	bool input_closed;
+	/**
+	 * @brief the number of commands whose status is not read yet
+	 */
+	uint32_t in_flight;
+	/**
+	 * @brief the size of one frame of the game
+	 */
+	size_t frame_size;
+	/**
+	 * @brief the frames that are not sent yet
+	 */
+	uint8_t output[OUTPUT_SIZE];
+	/**
+	 * @brief the number of bytes in output
+	 */
+	size_t output_length;
+	/**
+	 * @brief the number of bytes of output that are sent
+	 */
+	size_t output_sent;
+	/**
+	 * @brief true while the connection is in the pending list
+	 */
+	bool pending;
+	/**
+	 * @brief the next connection of the pending list
+	 */
+	struct connection *next_pending;
+	/**
+	 * @brief the previous connection of the list of all connections
+	 */
+	struct connection *prev;
+	/**
+	 * @brief the next connection of the list of all connections
+	 */
+	struct connection *next;
+};
+
+/* === GLOBALS === */
+
+extern void (*free_games)(void);
+
+/**
+ * @brief the shared memory of the server, kept out of the globals of shared.c so free_resources of the gateway does not remove it
+ */
+static int shm_id_clients = -1;
+
+/**
+ * @brief the pointer to the shared memory of a server
+ */
+static struct shared_server *server;
+
+/**
+ * @brief the pointer to the arena with the slots of all games
+ */
+static struct shared_arena *arena;
+
+/**
+ * @brief the epoll instance
+ */
+static int epoll_fd = -1;
+
+/**
+ * @brief the shard of the next new game
+ */
+static unsigned int next_shard = 0;
+
+/**
+ * @brief the connections that wait for the server
+ */
+static struct connection *pending = NULL;
+
+/**
+ * @brief all connections
+ */
+static struct connection *connections = NULL;
+
+/* === PROTOTYPES === */
+
+/**
+ * mandatory usage function
+ * @brief This function prints the usage information (SYNOPSIS) onto stderr
+ * @details uses global variable: program_name
+ */
+static void usage(void);
+
+/**
+ * @brief Parse command line options
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return the TCP port
+ */
+static uint16_t parse_args(int argc, char **argv);
+
+/**
+ * @brief attaches the shared memory of the server and maps the arena
+ * @details shm_id_clients, server, arena
+ */
+static void init_shared_memory( void );
+
+/**
+ * @brief creates the listening socket and the epoll instance
+ * @param port the TCP port
+ * @return the listening socket
+ * @details epoll_fd
+ */
+static int init_listener( uint16_t port );
+
+/**
+ * @brief accepts all waiting connections
+ * @param listener the listening socket
+ * @details epoll_fd, connections
+ */
+static void accept_connections( int listener );
+
+/**
+ * @brief puts a connection into the pending list if it is not in it yet
+ * @param conn the connection
+ * @details pending
+ */
+static void add_pending( struct connection *conn );
+
+/**
+ * @brief tells if a connection waits for the server
+ * @param conn the connection
+ * @return true if the registration or commands of the connection are not answered yet
+ */
+static bool is_busy( const struct connection *conn );
+
+/**
+ * @brief claims a registration slot and puts the request of a connection into the registration queue
+ * @param conn the connection with a complete hello
+ * @details server, next_shard
+ */
+static void request_registration( struct connection *conn );
+
+/**
+ * @brief writes commands into the command ring of the game of a connection and schedules the game
+ * @param conn the connection
+ * @param cmds the commands
+ * @param count the number of commands
+ * @details server
+ */
+static void send_commands( struct connection *conn, const uint8_t *cmds, size_t count );
+
+/**
+ * @brief appends the frame of a status to the output of a connection
+ * @param conn the connection
+ * @param status the status
+ */
+static void append_frame( struct connection *conn, unsigned int status );
+
+/**
+ * @brief tells how many bytes can be read from the socket of a connection
+ * @param conn the connection
+ * @return the rest of the hello or the number of commands that fit into the ring and the output, 0 if nothing is read
+ */
+static size_t input_room( const struct connection *conn );
+
+/**
+ * @brief reads the hello or commands of a connection
+ * @param conn the connection
+ */
+static void read_connection( struct connection *conn );
+
+/**
+ * @brief sends the output of a connection until the socket blocks
+ * @param conn the connection
+ */
+static void write_connection( struct connection *conn );
+
+/**
+ * @brief closes the socket of a connection whose remote client is gone, its game gets paused
+ * @param conn the connection
+ */
+static void hang_up( struct connection *conn );
+
+/**
+ * @brief takes the answers of the server to a connection
+ * @param conn the connection
+ * @return true if an answer was taken
+ * @details arena
+ */
+static bool poll_connection( struct connection *conn );
+
+/**
+ * @brief polls all pending connections
+ * @return true if an answer was taken
+ * @details pending
+ */
+static bool poll_pending( void );
+
+/**
+ * @brief closes a finished connection or one whose remote client shut down its side and got all frames, frees a connection
+ * that is gone and updates the epoll events of the others
+ * @details a connection in the pending list is freed after it leaves the list, so the call has to be the last use of conn
+ * @param conn the connection
+ * @details epoll_fd, connections
+ */
+static void settle( struct connection *conn );
+
+/**
+ * @brief pauses the games of all connections when the gateway is terminated
+ * @details called by free_resources, connections, server
+ */
+static void pause_connections( void );
+
+/* === IMPLEMENTATIONS === */
+
+static void usage(void)
+{
+	bail_out(EXIT_FAILURE, "USAGE: 2048-gateway [-p port]\n"
+	"\t-p:\tTCP port of the gateway (default: 2048)\n");
+}
+
+static uint16_t parse_args(int argc, char **argv)
+{
+	int getopt_result;
+	int p_flag = 0;
+	uint16_t port = GATEWAY_PORT_DEFAULT;
+
+	if(argc > 0) {
+		program_name = argv[0];
+	}
+
+	while ((getopt_result = getopt(argc, argv, "p:")) != -1) {
+		switch (getopt_result) {
+		case 'p':
+			if(p_flag != 0){
+				(void) usage();
+			}
+			p_flag = 1;
+			port = parse_number(optarg, "port", 1, 65535);
+			break;
+		case '?':
+			usage();
+			break;
+		default:
+			assert(0);
+		}
+	}
+
+	if(optind < argc){
+		(void) usage();
+	}
+
+	DEBUG("Parsing Arguments finished.\nPort: %d\n", port);
+	return port;
+}
+
+static void init_shared_memory( void )
+{
+	shm_id_clients = shmget(SHM_KEY, sizeof(struct shared_server), PERMISSION);
+	if (shm_id_clients < 0) {
+		(void) bail_out(EXIT_FAILURE,"Could not access the shared memory! Is there a online server?");
+	}
+	server = shmat(shm_id_clients, NULL, 0);
+	if (server == (struct shared_server*) -1) {
+		(void) bail_out(EXIT_FAILURE,"shmat failed (server)");
+	}
+	arena = map_arena(server->arena_path, false);
+	if (arena == NULL) {
+		(void) bail_out(EXIT_FAILURE,"can't map arena file %s", server->arena_path);
+	}
+}
+
+static int init_listener( uint16_t port )
+{
+	struct sockaddr_in address;
+	struct epoll_event event;
+	struct rlimit limit;
+	int yes = 1;
+
+	//every connection takes a file descriptor, the soft limit is often far below 10000
+	if(getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max){
+		limit.rlim_cur = limit.rlim_max;
+		(void) setrlimit(RLIMIT_NOFILE, &limit);
+	}
+
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	if(listener < 0){
+		(void) bail_out(EXIT_FAILURE,"socket");
+	}
+	(void) setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	if(bind(listener, (struct sockaddr *) &address, sizeof(address)) < 0){
+		(void) bail_out(EXIT_FAILURE,"can't bind port %d", port);
+	}
+	if(listen(listener, SOMAXCONN) < 0 || fcntl(listener, F_SETFL, O_NONBLOCK) < 0){
+		(void) bail_out(EXIT_FAILURE,"listen");
+	}
+
+	epoll_fd = epoll_create1(0);
+	if(epoll_fd < 0){
+		(void) bail_out(EXIT_FAILURE,"epoll_create1");
+	}
+	//the listener is the only event without a connection
+	event.events = EPOLLIN;
+	event.data.ptr = NULL;
+	if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listener, &event) < 0){
+		(void) bail_out(EXIT_FAILURE,"epoll_ctl listener");
+	}
+	return listener;
+}
+
+static void accept_connections( int listener )
+{
+	struct epoll_event event;
+	int yes = 1;
+
+	for(;;){
+		int fd = accept(listener, NULL, NULL);
+		if(fd < 0){
+			if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+				DEBUG("accept failed: %s\n", strerror(errno));
+			}
+			return;
+		}
+		struct connection *conn = calloc(1, sizeof(*conn));
+		if(conn == NULL || fcntl(fd, F_SETFL, O_NONBLOCK) < 0){
+			DEBUG("No memory for a connection\n");
+			free(conn);
+			(void) close(fd);
+			continue;
+		}
+		//frames are small and answer every command, they must not wait for more data
+		(void) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+		conn->fd = fd;
+		conn->state = CONN_HELLO;
+		conn->frame_size = GATEWAY_FRAME_HEADER;
+		conn->events = EPOLLIN;
+		event.events = conn->events;
+		event.data.ptr = conn;
+		if(epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0){
+			DEBUG("epoll_ctl failed: %s\n", strerror(errno));
+			free(conn);
+			(void) close(fd);
+			continue;
+		}
+		conn->next = connections;
+		if(connections != NULL){
+			connections->prev = conn;
+		}
+		connections = conn;
+	}
+}
+
+static void add_pending( struct connection *conn )
+{
+	if(!conn->pending){
+		conn->pending = true;
+		conn->next_pending = pending;
+		pending = conn;
+	}
+}
+
+static bool is_busy( const struct connection *conn )
+{
+	return conn->state == CONN_REGISTERING || conn->in_flight > 0;
+}
+
+static void request_registration( struct connection *conn )
+{
+	uint16_t wanted = conn->hello[2] << 8 | conn->hello[3];
+	//a paused game belongs to its shard, new games go to the shards in turn
+	struct shared_shard *shard = wanted != ID_UNSET ? game_shard(server, wanted) : &server->shard[next_shard++ % server->shards];
+	uint32_t index = __atomic_fetch_add(&shard->registration_hint, 1, __ATOMIC_RELAXED);
+
+	//unlike a client the gateway can not wait for a free slot, it tries again with the next poll
+	for(int tries = 0; tries < REGISTRATION_SLOTS; ++tries, ++index){
+		struct registration *slot = &shard->registrations[index % REGISTRATION_SLOTS];
+		uint32_t state = REG_FREE;
+		if(__atomic_compare_exchange_n(&slot->state, &state, (uint32_t) getpid(), false,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)){
+			slot->id = wanted;
+			slot->width = conn->hello[0];
+			slot->height = conn->hello[1];
+			slot->answered.count = 0;
+			slot->answered.waiters = 0;
+			slot->posted = monotonic_ns();
+
+			queue_push(shard->registration_queue, REGISTRATION_SLOTS, &shard->registration_tail,
+				(uint16_t) (slot - shard->registrations) + 1);
+			shared_sem_post(&shard->registrations_posted);
+			conn->request = slot;
+			return;
+		}
+	}
+	//a post without a request makes the server release the slots of dead clients
+	shared_sem_post(&shard->registrations_posted);
+}
+
+static void send_commands( struct connection *conn, const uint8_t *cmds, size_t count )
+{
+	for(size_t i = 0; i < count; ++i){
+		ring_push(&conn->game->commands, cmds[i]);
+		DEBUG("Wrote command '%d' of game %d to server\n",cmds[i],conn->id);
+	}
+	conn->in_flight += count;
+	schedule_game(server, conn->game, conn->id);
+	add_pending(conn);
+}
+
+static void append_frame( struct connection *conn, unsigned int status )
+{
+	uint8_t *frame = conn->output + conn->output_length;
+	int width = conn->game != NULL ? conn->game->field.width : 0;
+	int height = conn->game != NULL ? conn->game->field.height : 0;
+
+	if(conn->fd < 0){
+		return;
+	}
+	*frame++ = status;
+	*frame++ = width;
+	*frame++ = height;
+	*frame++ = conn->id >> 8;
+	*frame++ = conn->id & 0xFF;
+	for(int y = 0; y < height; ++y){
+		for(int x = 0; x < width; ++x){
+			*frame++ = FIELD_TILE(conn->game->field,x,y);
+		}
+	}
+	conn->output_length = frame - conn->output;
+}
+
+static size_t input_room( const struct connection *conn )
+{
+	if(conn->fd < 0 || conn->input_closed){
+		return 0;
+	}
+	if(conn->state == CONN_HELLO){
+		return GATEWAY_HELLO_SIZE - conn->hello_length;
+	}
+	if(conn->state != CONN_PLAYING){
+		return 0;
+	}
+	//a remote client that does not read its frames gets no more commands through
+	size_t frames = (OUTPUT_SIZE - conn->output_length) / conn->frame_size;
+	if(frames <= conn->in_flight){
+		return 0;
+	}
+	frames -= conn->in_flight;
+	return frames < GATEWAY_IN_FLIGHT - conn->in_flight ? frames : GATEWAY_IN_FLIGHT - conn->in_flight;
+}
+
+static void read_connection( struct connection *conn )
+{
+	uint8_t buffer[GAME_RING_SIZE];
+	size_t room;
+
+	while((room = input_room(conn)) > 0){
+		ssize_t length = read(conn->fd, buffer, room);
+		if(length < 0 && errno == EINTR){
+			continue;
+		}
+		if(length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+			return;
+		}
+		//the remote client sends no more commands, but it still reads the frames of the ones it sent
+		if(length == 0 && conn->state != CONN_HELLO){
+			conn->input_closed = true;
+			return;
+		}
+		if(length <= 0){
+			(void) hang_up(conn);
+			return;
+		}
+		if(conn->state == CONN_HELLO){
+			(void) memcpy(conn->hello + conn->hello_length, buffer, length);
+			conn->hello_length += length;
+			if(conn->hello_length == GATEWAY_HELLO_SIZE){
+				conn->state = CONN_REGISTERING;
+				(void) request_registration(conn);
+				(void) add_pending(conn);
+			}
+			continue;
+		}
+		size_t count = 0;
+		while(count < (size_t) length && buffer[count] <= CMD_DISCONNECT){
+			++count;
+		}
+		if(count > 0){
+			(void) send_commands(conn, buffer, count);
+		}
+		if(count < (size_t) length){
+			DEBUG("Invalid command %d of game %d\n", buffer[count], conn->id);
+			(void) hang_up(conn);
+			return;
+		}
+	}
+}
+
+static void write_connection( struct connection *conn )
+{
+	while(conn->output_sent < conn->output_length){
+		ssize_t length = write(conn->fd, conn->output + conn->output_sent, conn->output_length - conn->output_sent);
+		if(length < 0 && errno == EINTR){
+			continue;
+		}
+		if(length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+			return;
+		}
+		if(length < 0){
+			(void) hang_up(conn);
+			return;
+		}
+		conn->output_sent += length;
+	}
+	conn->output_sent = conn->output_length = 0;
+}
+
+static void hang_up( struct connection *conn )
+{
+	DEBUG("Connection of game %d is gone\n", conn->id);
+	//closing the socket removes it from the epoll instance
+	(void) close(conn->fd);
+	conn->fd = -1;
+	conn->output_sent = conn->output_length = 0;
+	if(conn->state == CONN_PLAYING){
+		//keep the game for later like a client at EOF
+		const uint8_t cmd = CMD_DISCONNECT;
+		(void) send_commands(conn, &cmd, 1);
+	}
+}
+
+static bool poll_connection( struct connection *conn )
+{
+	bool answered = false;
+
+	if(conn->state == CONN_REGISTERING){
+		if(conn->request == NULL){
+			(void) request_registration(conn);
+			return false;
+		}
+		if(!shared_sem_trywait(&conn->request->answered)){
+			return false;
+		}
+		conn->id = conn->request->id;
+		__atomic_store_n(&conn->request->state, REG_FREE, __ATOMIC_RELEASE);
+		conn->request = NULL;
+		if(conn->id == ID_UNSET){
+			DEBUG("The server could not open the game\n");
+			conn->state = CONN_FINISHED;
+			(void) append_frame(conn, ST_NOSUCHGAME);
+			return true;
+		}
+		conn->game = &arena->games[conn->id];
+		conn->frame_size = GATEWAY_FRAME_HEADER + conn->game->field.width * conn->game->field.height;
+		conn->state = CONN_PLAYING;
+		if(conn->fd < 0){
+			const uint8_t cmd = CMD_DISCONNECT;
+			(void) send_commands(conn, &cmd, 1);
+		} else{
+			(void) append_frame(conn, ST_ON);
+		}
+		answered = true;
+	}
+
+	while(conn->in_flight > 0 && shared_sem_trywait(&conn->game->status_posted)){
+		int status = ring_pop(&conn->game->statuses);
+		assert(status >= 0);
+		--conn->in_flight;
+		answered = true;
+		(void) append_frame(conn, status);
+		if(status == ST_WON || status == ST_LOST || status == ST_DELETE || status == ST_HALT){
+			//the server ignores the commands behind the last status
+			conn->in_flight = 0;
+			conn->state = CONN_FINISHED;
+			if(status != ST_HALT){
+				(void) free_game(arena, conn->id);
+			}
+		}
+	}
+	if(answered && conn->fd >= 0){
+		(void) write_connection(conn);
+	}
+	return answered;
+}
+
+static bool poll_pending( void )
+{
+	bool answered = false;
+	struct connection **link = &pending;
+
+	while(*link != NULL){
+		struct connection *conn = *link;
+		answered |= poll_connection(conn);
+		if(is_busy(conn)){
+			link = &conn->next_pending;
+		} else{
+			*link = conn->next_pending;
+			conn->pending = false;
+		}
+		(void) settle(conn);
+	}
+	return answered;
+}
+
+static void settle( struct connection *conn )
+{
+	if(conn->fd >= 0 && conn->state == CONN_FINISHED && conn->output_length == 0){
+		(void) close(conn->fd);
+		conn->fd = -1;
+	}
+	if(conn->fd >= 0 && conn->input_closed && !is_busy(conn) && conn->output_length == 0){
+		(void) hang_up(conn);
+	}
+	if(conn->fd < 0){
+		if(conn->pending){
+			return;
+		}
+		DEBUG("Free connection of game %d\n", conn->id);
+		if(conn->prev != NULL){
+			conn->prev->next = conn->next;
+		} else{
+			connections = conn->next;
+		}
+		if(conn->next != NULL){
+			conn->next->prev = conn->prev;
+		}
+		free(conn);
+		return;
+	}
+
+	uint32_t events = (input_room(conn) > 0 ? EPOLLIN : 0) | (conn->output_length > 0 ? EPOLLOUT : 0);
+	if(events != conn->events){
+		struct epoll_event event;
+		event.events = events;
+		event.data.ptr = conn;
+		if(epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn->fd, &event) < 0){
+			(void) bail_out(EXIT_FAILURE,"epoll_ctl");
+		}
+		conn->events = events;
+	}
+}
+
+static void pause_connections( void )
+{
+	for(struct connection *conn = connections; conn != NULL; conn = conn->next){
+		//a connection that is gone has its CMD_DISCONNECT in the ring already
+		if(conn->fd >= 0 && conn->state == CONN_PLAYING){
+			ring_push(&conn->game->commands, CMD_DISCONNECT);
+			schedule_game(server, conn->game, conn->id);
+		}
+	}
+}
+
+/**
+ * Program entry point
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE in case of an error
+ * @details global variables: program_name, epoll_fd, pending
+*/
+int main(int argc, char ** argv) {
+	struct epoll_event events[EVENTS_SIZE];
+	int idle = 0;
+
+	uint16_t port = parse_args(argc, argv);
+	(void) setup_signal_handler();
+	//a remote client that is gone must not kill the gateway
+	(void) signal(SIGPIPE, SIG_IGN);
+	(void) init_shared_memory();
+	int listener = init_listener(port);
+	free_games = pause_connections;
+
+	for(;;){
+		//the server answers within microseconds, so pending connections are polled in a busy loop before the gateway sleeps
+		int timeout = pending == NULL ? -1 : (idle < SEM_SPIN ? 0 : 1);
+		int count = epoll_wait(epoll_fd, events, EVENTS_SIZE, timeout);
+		if(count < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			(void) bail_out(EXIT_FAILURE,"epoll_wait");
+		}
+		for(int i = 0; i < count; ++i){
+			struct connection *conn = events[i].data.ptr;
+			if(conn == NULL){
+				(void) accept_connections(listener);
+				continue;
+			}
+			if(events[i].events & EPOLLERR){
+				(void) hang_up(conn);
+			} else{
+				if(events[i].events & EPOLLIN){
+					(void) read_connection(conn);
+				}
+				if(conn->fd >= 0 && (events[i].events & EPOLLOUT)){
+					(void) write_connection(conn);
+				}
+				//the remote client can not read the frames any more
+				if(conn->fd >= 0 && (events[i].events & EPOLLHUP)){
+					(void) hang_up(conn);
+				}
+			}
+			(void) settle(conn);
+		}
+		idle = poll_pending() || count > 0 ? 0 : idle + 1;
+	}
+}
@@ -0,0 +1,377 @@
+/**
+ * @file 2048-replay.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This tool replays the journal of a 2048-server. It checks every game against the checkpoints and ends in the journal or shows the board of one game after any number of moves
+ * @date 19.10.2026
+ */
+
+#include "gamelogic.h"
+#include "journal.h"
+#include "shared.h"
+#include <limits.h>
+#include <assert.h>
+#include <time.h>
+
+/* === TYPE DEFINITIONS === */
+
+/**
+ * @brief the state of a game of the journal
+ */
+struct replay_game
+{
+	/**
+	 * @brief the seed of the game
+	 */
+	uint64_t seed;
+	/**
+	 * @brief true while the state of the game is known
+	 */
+	bool live;
+	/**
+	 * @brief the board
+	 */
+	struct board field;
+	/**
+	 * @brief the random numbers of the new tiles
+	 */
+	rng_state rng;
+	/**
+	 * @brief the number of moves so far
+	 */
+	uint64_t moves;
+	/**
+	 * @brief the power of two to win
+	 */
+	unsigned int power_of_two;
+	/**
+	 * @brief the status of the last move
+	 */
+	unsigned int status;
+};
+
+/**
+ * @brief the totals of a replay
+ */
+struct replay_totals
+{
+	/**
+	 * @brief the number of records
+	 */
+	unsigned long records;
+	/**
+	 * @brief the number of games that ended in the journal
+	 */
+	unsigned long games;
+	/**
+	 * @brief the number of replayed moves
+	 */
+	unsigned long moves;
+	/**
+	 * @brief the number of checkpoints and ends that do not match the replay
+	 */
+	unsigned long mismatches;
+	/**
+	 * @brief the number of moves of games whose start is not in the journal
+	 */
+	unsigned long unknown;
+};
+
+/* === GLOBALS === */
+
+/**
+ * @brief the games indexed by their id in the journal
+ */
+static struct replay_game games[ARENA_SLOTS];
+
+/* === PROTOTYPES === */
+
+/**
+ * mandatory usage function
+ * @brief This function prints the usage information (SYNOPSIS) onto stderr
+ * @details uses global variable: program_name
+ */
+static void usage(void);
+
+/**
+ * @brief Parse command line options
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @param seed the seed of the game to show, 0 for all games
+ * @param target the number of moves after which the game is shown, ULONG_MAX for all moves
+ * @param verbose true to print every game that ends
+ * @return the path of the journal
+ */
+static const char *parse_args(int argc, char **argv, uint64_t *seed, unsigned long *target, bool *verbose);
+
+/**
+ * @brief finds the last checkpoint of a game before a number of moves
+ * @param file the journal
+ * @param seed the seed of the game
+ * @param target the number of moves
+ * @return the offset of the checkpoint in the journal, 0 if the game has to be replayed from its start
+ */
+static long find_checkpoint(FILE *file, uint64_t seed, unsigned long target);
+
+/**
+ * @brief sets the state of a game to a checkpoint
+ * @param game the game
+ * @param record the header of the checkpoint
+ * @param checkpoint the payload of the checkpoint
+ */
+static void load_checkpoint(struct replay_game *game, const struct journal_record *record, const struct journal_checkpoint *checkpoint);
+
+/**
+ * @brief applies one record to the games
+ * @param record the header
+ * @param payload the payload
+ * @param target the number of moves after which the moves of a game are not applied any more
+ * @param verbose true to print every game that ends
+ * @param totals the totals that are updated
+ */
+static void replay_record(const struct journal_record *record, const uint8_t *payload, unsigned long target,
+	bool verbose, struct replay_totals *totals);
+
+/**
+ * @brief prints the board of a game
+ * @param game the game
+ */
+static void print_game(const struct replay_game *game);
+
+/* === IMPLEMENTATIONS === */
+
+static void usage(void)
+{
+	bail_out(EXIT_FAILURE, "USAGE: 2048-replay [-s seed [-m moves]] [-v] journal\n"
+	"\t-s:\tShow the game with this seed\n"
+	"\t-m:\tShow the game after this number of moves (default: all moves)\n"
+	"\t-v:\tPrint every game that ends\n");
+}
+
+static const char *parse_args(int argc, char **argv, uint64_t *seed, unsigned long *target, bool *verbose)
+{
+	int getopt_result;
+	char *endptr;
+
+	*seed = 0;
+	*target = ULONG_MAX;
+	*verbose = false;
+
+	if(argc > 0) {
+		program_name = argv[0];
+	}
+
+	while ((getopt_result = getopt(argc, argv, "s:m:v")) != -1) {
+		switch (getopt_result) {
+		case 's':
+			//seeds take all 64 bits, more than parse_number takes
+			errno = 0;
+			*seed = strtoull(optarg, &endptr, 10);
+			if(errno != 0 || endptr == optarg || *endptr != '\0' || *seed == 0){
+				bail_out(EXIT_FAILURE, "parsing of seed failed! Use a number above 0");
+			}
+			break;
+		case 'm':
+			*target = parse_number(optarg, "moves", 0, LONG_MAX);
+			break;
+		case 'v':
+			*verbose = true;
+			break;
+		case '?':
+			usage();
+			break;
+		default:
+			assert(0);
+		}
+	}
+
+	if(optind != argc - 1 || (*target != ULONG_MAX && *seed == 0)){
+		(void) usage();
+	}
+
+	DEBUG("Parsing Arguments finished.\nSeed: %llu Moves: %lu\n", (unsigned long long) *seed, *target);
+	return argv[optind];
+}
+
+static long find_checkpoint(FILE *file, uint64_t seed, unsigned long target)
+{
+	struct journal_record record;
+	struct journal_checkpoint checkpoint;
+	long offset = 0;
+	long position = 0;
+
+	while(journal_read(file, &record, (uint8_t *) &checkpoint) > 0){
+		if(record.seed == seed && (record.type == JOURNAL_CHECKPOINT || record.type == JOURNAL_RESUME)
+			&& checkpoint.moves <= target){
+			offset = position;
+		}
+		position = ftell(file);
+	}
+	rewind(file);
+	return offset;
+}
+
+static void load_checkpoint(struct replay_game *game, const struct journal_record *record, const struct journal_checkpoint *checkpoint)
+{
+	game->seed = record->seed;
+	game->live = true;
+	game->field.width = record->count & 0xFF;
+	game->field.height = record->count >> 8;
+	(void) memcpy(game->field.rows, checkpoint->rows, sizeof(game->field.rows));
+	game->rng = checkpoint->rng;
+	game->moves = checkpoint->moves;
+	game->power_of_two = record->detail;
+	game->status = ST_ON;
+}
+
+static void replay_record(const struct journal_record *record, const uint8_t *payload, unsigned long target,
+	bool verbose, struct replay_totals *totals)
+{
+	struct replay_game *game = &games[record->id];
+	bool known = game->live && game->seed == record->seed;
+	const struct journal_checkpoint *checkpoint = (const struct journal_checkpoint *) payload;
+
+	++totals->records;
+	switch(record->type){
+		case JOURNAL_START:
+			game->seed = record->seed;
+			game->live = true;
+			seed_random(&game->rng, record->seed);
+			new_board(&game->field, record->count & 0xFF, record->count >> 8, &game->rng);
+			game->moves = 0;
+			game->power_of_two = record->detail;
+			game->status = ST_ON;
+			break;
+		case JOURNAL_CHECKPOINT:
+		case JOURNAL_RESUME:
+			if(known && game->moves == checkpoint->moves
+				&& (game->rng != checkpoint->rng || memcmp(game->field.rows, checkpoint->rows, sizeof(checkpoint->rows)) != 0)){
+				++totals->mismatches;
+				(void) fprintf(stderr, "%s: game %llu differs from its checkpoint after %llu moves\n", program_name,
+					(unsigned long long) record->seed, (unsigned long long) checkpoint->moves);
+			}
+			//a game that started before the journal or is behind a target starts here
+			if(!known || game->moves == checkpoint->moves){
+				load_checkpoint(game, record, checkpoint);
+			}
+			//the server of a resumed game may play to another power of two
+			game->power_of_two = record->detail;
+			break;
+		case JOURNAL_MOVES:
+			if(!known){
+				totals->unknown += record->count;
+				break;
+			}
+			for(int i = 0; i < record->count && game->moves < target; ++i){
+				unsigned int command = (payload[i / 4] >> (2 * (i % 4))) & 0x3;
+				game->status = move_numbers_board(&game->field, command, game->power_of_two, &game->rng);
+				++game->moves;
+				++totals->moves;
+			}
+			break;
+		case JOURNAL_END:
+			if(!known){
+				break;
+			}
+			if((record->detail == ST_WON || record->detail == ST_LOST) && record->detail != game->status
+				&& game->moves < target){
+				++totals->mismatches;
+				(void) fprintf(stderr, "%s: game %llu ended with status %d, the replay with %d\n", program_name,
+					(unsigned long long) record->seed, record->detail, game->status);
+			}
+			if(record->detail != ST_HALT){
+				++totals->games;
+				if(verbose){
+					printf("game %llu (id %d, %dx%d): %llu moves, status %d\n", (unsigned long long) game->seed,
+						record->id, game->field.width, game->field.height, (unsigned long long) game->moves, record->detail);
+				}
+				game->status = record->detail;
+				game->live = false;
+			}
+			break;
+		default:
+			assert(0);
+	}
+}
+
+static void print_game(const struct replay_game *game)
+{
+	printf("game %llu: %dx%d, %llu moves, status %d\n", (unsigned long long) game->seed,
+		game->field.width, game->field.height, (unsigned long long) game->moves, game->status);
+	for(int y = 0; y < game->field.height; ++y){
+		for(int x = 0; x < game->field.width; ++x){
+			if(FIELD_TILE(game->field,x,y) == 0){
+				printf("%6s", ".");
+			} else{
+				printf("%6u", 1u << FIELD_TILE(game->field,x,y));
+			}
+		}
+		printf("\n");
+	}
+}
+
+/**
+ * Program entry point
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE if the journal does not match the replay
+ */
+int main(int argc, char ** argv) {
+	uint64_t seed;
+	unsigned long target;
+	bool verbose;
+	struct replay_totals totals = { 0 };
+	struct journal_record record;
+	//aligned for the checkpoints
+	struct journal_checkpoint payload;
+	struct timespec start;
+	struct timespec end;
+	int result;
+
+	const char *path = parse_args(argc, argv, &seed, &target, &verbose);
+
+	FILE *file = fopen(path, "r");
+	if(file == NULL){
+		bail_out(EXIT_FAILURE, "can't open journal %s", path);
+	}
+	init_gamelogic();
+
+	(void) clock_gettime(CLOCK_MONOTONIC, &start);
+	if(seed != 0 && fseek(file, find_checkpoint(file, seed, target), SEEK_SET) < 0){
+		bail_out(EXIT_FAILURE, "fseek");
+	}
+	while((result = journal_read(file, &record, (uint8_t *) &payload)) > 0){
+		if(seed == 0 || record.seed == seed){
+			replay_record(&record, (const uint8_t *) &payload, target, verbose, &totals);
+		}
+	}
+	(void) clock_gettime(CLOCK_MONOTONIC, &end);
+	if(result < 0){
+		(void) fprintf(stderr, "%s: the journal is cut off after %lu records\n", program_name, totals.records);
+	}
+	(void) fclose(file);
+
+	if(seed != 0){
+		bool found = false;
+		for(int id = 0; id < ARENA_SLOTS; ++id){
+			if(games[id].seed == seed){
+				print_game(&games[id]);
+				found = true;
+			}
+		}
+		if(!found){
+			bail_out(EXIT_FAILURE, "no game with seed %llu in %s", (unsigned long long) seed, path);
+		}
+	}
+
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("records: %lu\n", totals.records);
+	printf("games:   %lu ended\n", totals.games);
+	printf("moves:   %lu (%.0f moves/s)\n", totals.moves, totals.moves / seconds);
+	if(totals.unknown > 0){
+		printf("unknown: %lu moves of games that started before the journal\n", totals.unknown);
+	}
+	printf("differ:  %lu\n", totals.mismatches);
+
+	return totals.mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -2,117 +2,312 @@
  * @file 2048-server.c
  * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
  * @brief The server of a 2048 game. It gets commands from clients handles them, updates the game field and passes the new field and game status to the client
+ * @details one process serves all games: the main thread registers clients and a small pool of worker threads handles the commands of the games in the ready queue
  * @date 26.04.2014
  */
 
 #include "gamelogic.h"
 #include "shared.h"
+#include "journal.h"
+#include <fcntl.h>
 #include <limits.h>
 #include <assert.h>
 #include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
 
-extern int shm_id_game;
-extern int shm_id_clients;
-extern int sem_client;
-extern int sem_client2;
-extern int s1;
-extern int s2;
-extern int s3;
-extern int s4;
+/* === CONSTANTS === */
 
 /**
- * @brief the pointer to the shared memory of a game
+ * @brief the default number of worker threads
  */
-static struct shared_game *game;
+#define WORKERS_DEFAULT		(2)
+
+/* === MACROS === */
+
+/**
+ * @def STAT_ADD(counters,field,n)
+ * @brief Adds n to a counter of a thread. Only the thread writes its counters, so a relaxed load and store are enough
+ */
+#define STAT_ADD(counters,field,n) \
+	__atomic_store_n(&(counters)->field, __atomic_load_n(&(counters)->field, __ATOMIC_RELAXED) + (n), __ATOMIC_RELAXED)
+
+/* === GLOBALS === */
+
+extern int shm_id_clients;
+extern int shm_id_stats;
+extern void (*free_games)(void);
 
 /**
  * @brief the pointer to the shared memory of a server
  */
 static struct shared_server *server;
 
+/**
+ * @brief the registration channel and ready queue of this process
+ */
+static struct shared_shard *shard;
+
+/**
+ * @brief the number of server processes
+ */
+static unsigned int shards;
+
+/**
+ * @brief the index of the shard of this process, 0 in the first process
+ */
+static unsigned int shard_index = 0;
+
+/**
+ * @brief the process ids of the other shards, only known to the first process
+ */
+static pid_t children[SHARDS_MAX];
+
+/**
+ * @brief the pointer to the arena with the slots of all games
+ */
+static struct shared_arena *arena;
+
+/**
+ * @brief the statistics of the server
+ */
+static struct shared_stats *stats;
+
+/**
+ * @brief the counters of the main thread of this process
+ */
+static struct stats_counters *main_counters;
+
+/**
+ * @brief the power of two to win a game
+ */
+static unsigned int power_of_two;
+
+/**
+ * @brief the random numbers the seeds of new games are drawn from
+ */
+static rng_state seeds;
+
+/**
+ * @brief the journal of the moves of all games, -1 if there is none
+ */
+static int journal = -1;
+
+/**
+ * @brief the next entry of the ready queue a worker takes
+ */
+static uint32_t ready_head = 0;
+
+/**
+ * @brief protects ready_head between the workers
+ */
+static pthread_mutex_t ready_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief the next entry of the registration queue the main thread takes
+ */
+static uint32_t registration_head = 0;
+
+/**
+ * @brief the worker threads of this process
+ */
+static pthread_t worker_threads[STATS_THREADS];
+
+/**
+ * @brief the number of started worker threads
+ */
+static long worker_count = 0;
+
+/**
+ * @brief set by free_server_games, the workers return when they see it
+ */
+static uint32_t stopping = 0;
+
+/**
+ * @brief the signals that stop the server, they are blocked in all threads and taken by wait_signal
+ */
+static sigset_t stop_signals;
+
+/**
+ * @brief the signal that stops the server, 0 until one came
+ */
+static uint32_t stop_signal = 0;
+
 /* === PROTOTYPES */
 
 /**
- * @brief Initializes the semaphores of a new game
- * @param key the id of the new game
- * @details s1,s2,s3,s4
+ * @brief creates a shared memory segment that no other process uses
+ * @details the segment of a server that still runs is kept and the server refuses to start, the segment of a server that was
+ * killed is removed and created again
+ * @param key the key of the segment
+ * @param size the size of the segment
+ * @param permission the permission of the segment
+ * @return the id of the segment
  */
-static void init_semaphors( key_t key );
+static int create_segment( key_t key, size_t size, int permission );
 
 /**
- * @brief initialize shared memory of the server and initializes the semaphores of the server
- * @details shm_id_clients, server, sem_client, sem_client2
+ * @brief initialize shared memory of the server with empty queues
+ * @details shm_id_clients, server
  */
 static void init_shared_memory( void );
 
 /**
- * @brief initialize shared memory of new game, starts the game and initializes the semaphoes of it
+ * @brief creates the shared memory of the statistics with all counters 0
+ * @param workers the number of worker threads
+ * @details shm_id_stats, stats
+ */
+static void init_stats( long workers );
+
+/**
+ * @brief maps the arena file and rebuilds the free lists of the shards, paused games of an earlier server are kept
+ * @param path the path of the arena file
+ * @details arena, server, shards
+ */
+static void init_arena( const char *path );
+
+/**
+ * @brief forks a process for every further shard and pins every process to a core of its own
+ * @details shard_index, shard, children, seeds, main_counters
+ */
+static void start_shards( void );
+
+/**
+ * @brief pins the calling process and the threads it creates later to one core
+ * @param core the index of the core, modulo the number of online cores
+ */
+static void pin_to_core( unsigned int core );
+
+/**
+ * @brief empties the rings of a game and unschedules it before a client connects to it
+ * @param game the game
+ */
+static void reset_game( struct shared_game *game );
+
+/**
+ * @brief starts a new game in a free slot of the shard
+ * @param width the number of tiles of a row
+ * @param height the number of rows
+ * @return the id of the game, ID_UNSET if the arena is full or the size is not valid
+ * @details arena, seeds, journal, stats
+ */
+static uint16_t create_game( unsigned int width, unsigned int height );
+
+/**
+ * @brief reconnects to a paused game
  * @param key the id of the game
- * @details shm_id_game, game
+ * @return 0 on success, -1 if the game is not paused
+ * @details arena, journal, stats
  */
-static void init_shared_game( key_t key );
+static int reconnect_to_game( uint16_t key );
 
 /**
- * mandatory usage function
- * @brief This function prints the usage information (SYNOPSIS) onto stderr
- * @details uses global variable: program_name
+ * @brief answers a request of the registration queue, the slot of a client that is gone is released instead
+ * @param request the registration slot
+ * @details stats
  */
-static void usage(void);
+static void answer_request( struct registration *request );
 
 /**
- * @brief Parse command line options
- * @param argc The argument counter
- * @param argv The argument vector
- * @param power_of_two the power of two that gets set by the parsed argument vector or set to default value
+ * @brief answers the requests in the registration queue of the shard until it is empty
+ * @return true if a request was taken
+ * @details shard, registration_head
+ */
+static bool take_requests( void );
+
+/**
+ * @brief releases the registration slots of clients that died before their request was queued
+ * @details shard
+ */
+static void release_registrations( void );
+
+/**
+ * @brief waits for a post of the registration queue of the shard and answers the requests
+ * @details a post only wakes the main thread. A client that finds no free slot posts without a request, so the slots of
+ * dead clients are released. shard
+ */
+static void answer_registration( void );
+
+/**
+ * @brief stops the workers, then deletes the games of the shard that are not paused and wakes their clients and the clients that wait for registration. The arena file is written back to disk
+ * @details called by free_resources. A shard other than the first one detaches the shared memory and exits right away, so
+ * free_resources does not return there. arena, shard, children, worker_threads, stopping
+ */
+static void free_server_games( void );
+
+/**
+ * @brief handles the commands of a game until its ring is empty and the game is unscheduled, or until its last status
+ * @param key the id of the game
+ * @param counters the struct stats_counters of the worker
+ * @details arena, journal, power_of_two
+ */
+static void play_game( uint16_t key, struct stats_counters *counters );
+
+/**
+ * @brief the worker thread: takes games from the ready queue and handles their commands
+ * @details a post of ready_posted only wakes the worker, it takes games until the queue is empty. Surplus posts find an empty queue
+ * @param argument the struct stats_counters of the worker
+ * @return NULL
+ * @details shard, ready_head, ready_lock
  */
-static void parse_args(int argc, char **argv, unsigned int *power_of_two);
+static void *run_worker( void *argument );
 
 /**
- * @brief free allocated resources of one game but not the parent server and prints error messages if something fails
- * @details global variables: shm_id_game, s1, s2, s3, s4
+ * @brief the signal thread: waits for a stop signal and wakes the main thread, which shuts the server down outside of a signal handler
+ * @param argument unused
+ * @return NULL
+ * @details stop_signals, stop_signal, shard
  */
-static void close_game( void );
+static void *wait_signal( void *argument );
 
 /**
- * @brief pauses the game and closes the child server the shared memory gets detached but not removed. The semaphores get removed carefully
- * @details s1, s2, s3, s4, server
+ * mandatory usage function
+ * @brief This function prints the usage information (SYNOPSIS) onto stderr
+ * @details uses global variable: program_name
  */
-static void pause_game (void);
+static void usage(void);
 
 /**
- * @brief reconnect to an existing shared memory game and create the semaphores for it
- * @param key the id of the shared game
- * @details shm_id_game, server
+ * @brief Parse command line options
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @param workers the number of worker threads
+ * @param path the path of the arena file
+ * @param journal_path the path of the journal, NULL for none
+ * @details power_of_two, shards and seeds get set by the parsed argument vector or set to default value
  */
-static void reconnect_to_game (key_t key);
+static void parse_args(int argc, char **argv, long *workers, const char **path, const char **journal_path);
 
 
 /* === IMPLEMENTATIONS === */
 
 
-static void init_semaphors( key_t key )
+static int create_segment( key_t key, size_t size, int permission )
 {
-	s1 = seminit(SEM_KEY + 5*key + 1, PERMISSION, 0);
-	if (s1 < 0) {
-		(void) bail_out(EXIT_FAILURE,"seminit (1) failed");
-	}
-	s2 = seminit(SEM_KEY + 5*key + 2, PERMISSION, 1);
-	if (s2 < 0) {
-		(void) bail_out(EXIT_FAILURE,"seminit (2) failed");
-	}
-	s3 = seminit(SEM_KEY + 5*key + 3, PERMISSION, 0);
-	if (s3 < 0) {
-		(void) bail_out(EXIT_FAILURE,"seminit (2) failed");
-	}
-	s4 = seminit(SEM_KEY + 5*key + 4, PERMISSION, 0);
-	if (s4 < 0) {
-		(void) bail_out(EXIT_FAILURE,"seminit (2) failed");
+	int shm_id = shmget(key, size, IPC_CREAT | IPC_EXCL | permission);
+	if (shm_id < 0 && errno == EEXIST) {
+		struct shmid_ds info;
+		int old_id = shmget(key, 0, 0);
+		if (old_id < 0 || shmctl(old_id, IPC_STAT, &info) < 0) {
+			return -1;
+		}
+		//the creator of the segment is the first process of the server
+		if (kill(info.shm_cpid, 0) == 0 || errno == EPERM) {
+			errno = 0;
+			(void) bail_out(EXIT_FAILURE,"a server with pid %d is already running", (int) info.shm_cpid);
+		}
+		DEBUG("Removing the shared memory %d of the killed server %d\n", old_id, (int) info.shm_cpid);
+		(void) shmctl(old_id, IPC_RMID, NULL);
+		shm_id = shmget(key, size, IPC_CREAT | IPC_EXCL | permission);
 	}
+	return shm_id;
 }
 
 static void init_shared_memory( void )
 {
-	shm_id_clients = shmget(SHM_KEY, sizeof(struct shared_server), IPC_CREAT | PERMISSION);
+	shm_id_clients = create_segment(SHM_KEY, sizeof(struct shared_server), PERMISSION);
 	if (shm_id_clients < 0) {
 		(void) bail_out(EXIT_FAILURE,"shmget failed clients");
 	}
@@ -121,87 +316,462 @@ static void init_shared_memory( void )
 		(void) bail_out(EXIT_FAILURE,"shmat failed clients");
 	}
 
-	server->id = ID_UNSET;
-	server->number_clients = 0;
+	//the segment is new, no other server uses it: all slots REG_FREE, all queues empty
+	memset(server, 0, sizeof(*server));
+	server->shards = shards;
+}
+
+static void init_stats( long workers )
+{
+	shm_id_stats = create_segment(STATS_KEY, sizeof(struct shared_stats), STATS_PERMISSION);
+	if (shm_id_stats < 0) {
+		(void) bail_out(EXIT_FAILURE,"shmget failed stats");
+	}
+	stats = shmat(shm_id_stats, NULL, 0);
+	if (stats == (struct shared_stats*) -1) {
+		(void) bail_out(EXIT_FAILURE,"shmat failed stats");
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	stats->started = monotonic_ns();
+	stats->workers = shards * workers;
+}
+
+static void init_arena( const char *path )
+{
+	arena = map_arena(path, true);
+	if (arena == NULL) {
+		(void) bail_out(EXIT_FAILURE,"can't map arena file %s", path);
+	}
+	if (realpath(path, server->arena_path) == NULL) {
+		(void) bail_out(EXIT_FAILURE,"realpath of %s", path);
+	}
+
+	//a new file or one with another layout has no games to keep
+	bool valid = arena->magic == ARENA_MAGIC && arena->version == ARENA_VERSION
+		&& arena->slot_size == sizeof(struct shared_game) && arena->slots == ARENA_SLOTS;
+	arena->magic = ARENA_MAGIC;
+	arena->version = ARENA_VERSION;
+	arena->slot_size = sizeof(struct shared_game);
+	arena->slots = ARENA_SLOTS;
+	arena->shards = shards;
+
+	//the lowest ids are pushed last and are used first
+	for(unsigned int i = 0; i < SHARDS_MAX; ++i){
+		arena->free_head[i] = ID_UNSET;
+	}
+	arena->number_clients = 0;
+	for(int key = ID_MAX; key >= ID_MIN; --key){
+		struct shared_game *game = &arena->games[key];
+		if(valid && game->state == GAME_PAUSED){
+			++arena->number_clients;
+		} else{
+			game->state = GAME_FREE;
+			game->next_free = arena->free_head[key % shards];
+			arena->free_head[key % shards] = key;
+		}
+	}
+	stats->paused_start = arena->number_clients;
+	DEBUG("Arena has %u paused games\n",arena->number_clients);
+}
+
+static void start_shards( void )
+{
+	for(unsigned int i = 1; i < shards; ++i){
+		pid_t pid = fork();
+		if(pid < 0){
+			(void) bail_out(EXIT_FAILURE,"fork of shard %u", i);
+		}
+		if(pid == 0){
+			shard_index = i;
+			//a shard that bails out must not remove the segments of the first process
+			shm_id_clients = -1;
+			shm_id_stats = -1;
+			//only the first process stops the others
+			memset(children, 0, sizeof(children));
+			//a shard must not outlive the first process, it would serve games nobody cleans up
+			(void) prctl(PR_SET_PDEATHSIG, SIGTERM);
+			if(getppid() == 1){
+				(void) bail_out(EXIT_FAILURE,"first process is gone");
+			}
+			//the shards would draw the same seeds from the copied state
+			uint64_t seed = (uint64_t) next_random(&seeds) << 32 | next_random(&seeds);
+			seed_random(&seeds, seed + i);
+			break;
+		}
+		children[i] = pid;
+	}
+	shard = &server->shard[shard_index];
+	main_counters = &stats->threads[shard_index * (stats->workers / shards + 1)];
+	if(shards > 1){
+		(void) pin_to_core(shard_index);
+	}
+	DEBUG("Shard %u of %u started with pid %d\n",shard_index,shards,getpid());
+}
+
+static void pin_to_core( unsigned int core )
+{
+	unsigned long mask[1024 / (8 * sizeof(unsigned long))];
+	long cores = sysconf(_SC_NPROCESSORS_ONLN);
 
-	sem_client = seminit(SEM_KEY, PERMISSION, 0);
-	if (sem_client < 0) {
-		(void) bail_out(EXIT_FAILURE,"seminit (sem_client) failed");
+	if(cores < 1){
+		cores = 1;
+	}
+	core %= cores;
+	memset(mask, 0, sizeof(mask));
+	mask[core / (8 * sizeof(unsigned long))] = 1UL << (core % (8 * sizeof(unsigned long)));
+	//the system call needs no _GNU_SOURCE for the CPU_SET macros
+	if(syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) < 0){
+		DEBUG("Shard %u could not be pinned to core %u: %s\n",shard_index,core,strerror(errno));
 	}
+}
 
-	sem_client2 = seminit(SEM_KEY+1, PERMISSION, 0);
-	if (sem_client2 < 0) {
-		(void) bail_out(EXIT_FAILURE,"seminit (sem_client2) failed");
+static void reset_game( struct shared_game *game )
+{
+	//commands and posts of a server that did not shut down cleanly must not reach the next client
+	game->commands.head = game->commands.tail = 0;
+	game->statuses.head = game->statuses.tail = 0;
+	game->status_posted.count = 0;
+	game->status_posted.waiters = 0;
+	game->scheduled = 0;
+}
+
+static uint16_t create_game( unsigned int width, unsigned int height )
+{
+	if(width < FIELD_SIZE_MIN || width > FIELD_SIZE_MAX || height < FIELD_SIZE_MIN || height > FIELD_SIZE_MAX){
+		DEBUG("Invalid size %ux%u\n",width,height);
+		return ID_UNSET;
+	}
+	uint16_t key = alloc_game(arena, shard_index);
+	if(key == ID_UNSET){
+		return ID_UNSET;
+	}
+	DEBUG("Create %ux%u game with key %d\n",width,height,key);
+
+	struct shared_game *game = &arena->games[key];
+	//only the main thread of the shard creates its games, so they get their seeds in the order of registration
+	game->seed = (uint64_t) next_random(&seeds) << 32 | next_random(&seeds);
+	seed_random(&game->rng, game->seed);
+	new_board(&game->field, width, height, &game->rng);
+	(void) reset_game(game);
+	//the journal starts with the seed, the replay spawns the first tile itself
+	journal_start(journal, key, game, power_of_two);
+	game->state = GAME_ON;
+	STAT_ADD(main_counters, created, 1);
+	return key;
+}
+
+static int reconnect_to_game( uint16_t key )
+{
+	uint32_t state = GAME_PAUSED;
+
+	DEBUG("Reconnect to game %d\n",key);
+	//a client routes the id to its shard, but a wrong one must not take the game of another shard
+	if(key < ID_MIN || key % shards != shard_index || !__atomic_compare_exchange_n(&arena->games[key].state, &state, GAME_ON, false,
+		__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)){
+		return -1;
 	}
+	(void) reset_game(&arena->games[key]);
+	journal_resume(journal, key, &arena->games[key], power_of_two);
+	STAT_ADD(main_counters, resumed, 1);
+	return 0;
 }
 
-static void init_shared_game( key_t key )
+static void answer_request( struct registration *request )
 {
-	DEBUG("Create shared game with key %d\n",key);
-	shm_id_game = shmget(SHM_KEY+key, sizeof(struct shared_game), IPC_CREAT | PERMISSION);
-	if (shm_id_game < 0) {
-		(void) bail_out(EXIT_FAILURE,"shmget failed game");
+	pid_t owner = (pid_t) __atomic_load_n(&request->state, __ATOMIC_ACQUIRE);
+
+	//nobody would free a game for a client that is gone
+	if(kill(owner, 0) < 0 && errno == ESRCH){
+		DEBUG("Client %d is gone before its answer\n",owner);
+		__atomic_store_n(&request->state, REG_FREE, __ATOMIC_RELEASE);
+		return;
+	}
+	if(request->id == ID_UNSET){
+		request->id = create_game(request->width, request->height);
+		if(request->id == ID_UNSET){
+			DEBUG("No free slot for a new game\n");
+		}
+	} else if(reconnect_to_game(request->id) < 0){
+		DEBUG("Could not reconnect to game %d\n",request->id);
+		request->id = ID_UNSET;
 	}
-	game = shmat(shm_id_game, NULL, 0);
-	if (game == (struct shared_game*) -1) {
-		(void) bail_out(EXIT_FAILURE,"shmat failed game");
+	if(request->id == ID_UNSET){
+		STAT_ADD(main_counters, refused, 1);
 	}
 
-	new_game(game->field);
+	//the handshake takes from the post of the client up to the answer
+	uint64_t latency = (monotonic_ns() - request->posted) / 1000;
+	int bucket = 0;
+	while(latency > 0 && bucket < STATS_LATENCY_BUCKETS - 1){
+		latency >>= 1;
+		++bucket;
+	}
+	(void) __atomic_fetch_add(&stats->handshakes[bucket], 1, __ATOMIC_RELAXED);
+	shared_sem_post(&request->answered);
+}
 
-	game->status = ST_ON;
-	game->command = CMD_UNSET;
+static bool take_requests( void )
+{
+	bool taken = false;
+	uint16_t index;
 
-	(void) init_semaphors( key );	
+	while((index = queue_pop(shard->registration_queue, REGISTRATION_SLOTS, &registration_head)) != 0){
+		(void) answer_request(&shard->registrations[index - 1]);
+		taken = true;
+	}
+	return taken;
 }
 
+static void release_registrations( void )
+{
+	uint32_t gone[REGISTRATION_SLOTS];
+
+	for(int i = 0; i < REGISTRATION_SLOTS; ++i){
+		gone[i] = __atomic_load_n(&shard->registrations[i].state, __ATOMIC_ACQUIRE);
+		if(gone[i] != REG_FREE && (kill((pid_t) gone[i], 0) == 0 || errno != ESRCH)){
+			gone[i] = REG_FREE;
+		}
+	}
+	//a dead client queues no more requests, so a slot that is still claimed after the queue is empty is not in it
+	(void) take_requests();
+	for(int i = 0; i < REGISTRATION_SLOTS; ++i){
+		if(gone[i] != REG_FREE && __atomic_compare_exchange_n(&shard->registrations[i].state, &gone[i], REG_FREE, false,
+			__ATOMIC_RELEASE, __ATOMIC_RELAXED)){
+			DEBUG("Released the registration slot of client %u\n",gone[i]);
+		}
+	}
+}
+
+static void answer_registration( void )
+{
+	shared_sem_wait(&shard->registrations_posted);
+	if(!take_requests()){
+		(void) release_registrations();
+	}
+}
+
+static void free_server_games( void )
+{
+	uint32_t paused = 0;
 
+	for(unsigned int i = 1; i < shards; ++i){
+		if(children[i] > 0){
+			(void) kill(children[i], SIGTERM);
+		}
+	}
+	if(shard != NULL){
+		//afterwards this thread is the only one that writes the statuses of the games
+		__atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+		for(long i = 0; i < worker_count; ++i){
+			shared_sem_post(&shard->ready_posted);
+		}
+		for(long i = 0; i < worker_count; ++i){
+			//a worker that bails out stops the others
+			if(!pthread_equal(worker_threads[i], pthread_self())){
+				(void) pthread_join(worker_threads[i], NULL);
+			}
+		}
+		for(int i = 0; i < REGISTRATION_SLOTS; ++i){
+			if(shard->registrations[i].state != REG_FREE){
+				shard->registrations[i].id = ID_UNSET;
+				shared_sem_post(&shard->registrations[i].answered);
+			}
+		}
+	}
+	if(arena != NULL){
+		for(int key = ID_MIN + (shards + shard_index - ID_MIN % shards) % shards; key <= ID_MAX; key += shards){
+			struct shared_game *game = &arena->games[key];
+			if(game->state == GAME_ON){
+				//a client has less than GAME_RING_SIZE commands in flight, so there is room for one more status. The next server frees the slot
+				game->state = GAME_CLOSED;
+				ring_push(&game->statuses, ST_DELETE);
+				shared_sem_post(&game->status_posted);
+			} else if(game->state == GAME_OVER){
+				//the client of a finished game must not free the slot after the next server rebuilt the free lists
+				uint32_t state = GAME_OVER;
+				(void) __atomic_compare_exchange_n(&game->state, &state, GAME_CLOSED, false,
+					__ATOMIC_RELAXED, __ATOMIC_RELAXED);
+			} else if(game->state == GAME_PAUSED){
+				++paused;
+			}
+		}
+		//paused games survive until the next server, even if the host goes down
+		DEBUG("%u paused games are kept in %s\n",paused,server->arena_path);
+		(void) msync(arena, sizeof(struct shared_arena), MS_SYNC);
+	}
+	//only the first process removes the shared memory, the clients and the other shards still use it
+	if(shard_index != 0){
+		(void) shmdt(server);
+		(void) shmdt(stats);
+		_exit(EXIT_FAILURE);
+	}
+}
+
+static void play_game( uint16_t key, struct stats_counters *counters )
+{
+	struct shared_game *game = &arena->games[key];
+	for(;;){
+		int cmd;
+		while(game->state == GAME_ON && (cmd = ring_pop(&game->commands)) >= 0){
+			unsigned int status = move_numbers_board(&game->field,cmd,power_of_two,&game->rng);
+			DEBUG("Game %d got:\t%d\n", key, cmd);
+			if(cmd <= CMD_DOWN){
+				journal_move(journal, key, game, cmd, power_of_two);
+				STAT_ADD(counters, moves, 1);
+			}
+			uint32_t state = GAME_ON;
+			if(status == ST_HALT){
+				journal_end(journal, key, game, status);
+				state = GAME_PAUSED;
+				STAT_ADD(counters, paused, 1);
+			} else if(status == ST_DELETE || status == ST_WON || status == ST_LOST){
+				if(status == ST_WON){
+					STAT_ADD(counters, won, 1);
+				} else if(status == ST_LOST){
+					STAT_ADD(counters, lost, 1);
+				} else{
+					STAT_ADD(counters, deleted, 1);
+				}
+				journal_end(journal, key, game, status);
+				//the client frees the slot after it read the last status
+				state = GAME_OVER;
+			}
+			ring_push(&game->statuses, status);
+			shared_sem_post(&game->status_posted);
+			if(state != GAME_ON){
+				//a reconnect or a new game resets the slot as soon as it sees the state, so it is the last access of the worker.
+				//The game stays scheduled, a late command must not hand it to another worker, reset_game unschedules it
+				__atomic_store_n(&game->state, state, __ATOMIC_RELEASE);
+				return;
+			}
+		}
+		//commands the client wrote before it saw the game unscheduled are handled here
+		__atomic_store_n(&game->scheduled, 0, __ATOMIC_SEQ_CST);
+		if(game->state != GAME_ON || __atomic_load_n(&stopping, __ATOMIC_ACQUIRE)
+			|| game->commands.head == __atomic_load_n(&game->commands.tail, __ATOMIC_SEQ_CST)
+			|| __atomic_exchange_n(&game->scheduled, 1, __ATOMIC_SEQ_CST) != 0){
+			return;
+		}
+	}
+}
+
+static void *run_worker( void *argument )
+{
+	struct stats_counters *counters = argument;
+
+	for(;;){
+		uint64_t start = monotonic_ns();
+		__atomic_store_n(&counters->wait_since, start, __ATOMIC_RELAXED);
+		shared_sem_wait(&shard->ready_posted);
+		__atomic_store_n(&counters->wait_since, 0, __ATOMIC_RELAXED);
+		STAT_ADD(counters, wait_ns, monotonic_ns() - start);
+
+		//the queue is emptied, a game whose client died before its post is taken with the next post
+		for(;;){
+			if(__atomic_load_n(&stopping, __ATOMIC_ACQUIRE)){
+				return NULL;
+			}
+			(void) pthread_mutex_lock(&ready_lock);
+			uint16_t key = queue_pop(shard->ready, READY_QUEUE_SIZE, &ready_head);
+			(void) pthread_mutex_unlock(&ready_lock);
+			if(key == ID_UNSET){
+				break;
+			}
+			(void) play_game(key, counters);
+		}
+	}
+	return NULL;
+}
+
+static void *wait_signal( void *argument )
+{
+	int sig;
+
+	(void) argument;
+	if(sigwait(&stop_signals, &sig) == 0){
+		__atomic_store_n(&stop_signal, sig, __ATOMIC_RELEASE);
+		shared_sem_post(&shard->registrations_posted);
+	}
+	return NULL;
+}
 
 static void usage(void)
 {
-	bail_out(EXIT_FAILURE, "USAGE: 2048-server [-p power_of_two]\n"
-	"\t-p:\tPlay until 2^power_of_two is reached (default: 11)\n");
+	bail_out(EXIT_FAILURE, "USAGE: 2048-server [-p power_of_two] [-n shards] [-t workers] [-f file] [-s seed] [-j journal]\n"
+	"\t-p:\tPlay until 2^power_of_two is reached (default: 11)\n"
+	"\t-n:\tNumber of server processes, each pinned to a core and serving the ids modulo n (default: 1)\n"
+	"\t-t:\tNumber of worker threads of every process (default: 2)\n"
+	"\t-f:\tFile that keeps the games (default: " ARENA_FILE_DEFAULT ")\n"
+	"\t-s:\tSeed of the seeds of the games (default: time and process id)\n"
+	"\t-j:\tAppend the seeds and moves of all games to this journal (default: none)\n");
 }
 
-static void parse_args(int argc, char **argv, unsigned int *power_of_two)
+static void parse_args(int argc, char **argv, long *workers, const char **path, const char **journal_path)
 {
-	char *endptr;
 	int getopt_result;
-	long p_arg = 0;
 	int p_flag = 0;
-
-	*power_of_two = POWER_OF_TWO_DEFAULT;
+	int n_flag = 0;
+	int t_flag = 0;
+	int f_flag = 0;
+	int s_flag = 0;
+	int j_flag = 0;
+	uint64_t seed = (uint64_t) time(NULL) << 32 | getpid();
+
+	power_of_two = POWER_OF_TWO_DEFAULT;
+	shards = 1;
+	*workers = WORKERS_DEFAULT;
+	*path = ARENA_FILE_DEFAULT;
+	*journal_path = NULL;
 
 	if(argc > 0) {
 		program_name = argv[0];
 	}
 
-	
-	while ((getopt_result = getopt(argc, argv, "p:")) != -1) {
+
+	while ((getopt_result = getopt(argc, argv, "p:n:t:f:s:j:")) != -1) {
 		switch (getopt_result) {
 		case 'p':
 	   		if(p_flag != 0){
 				(void) usage();
 			}
 			p_flag = 1;
-			p_arg = strtol(optarg, &endptr, 10);
-			if((errno == ERANGE && (p_arg == LONG_MAX || p_arg == LONG_MIN)) 
-				|| (errno != 0 && p_arg == 0)) {
-				bail_out(EXIT_FAILURE, "parsing of power_of_two failed! (strtol)");
+			power_of_two = parse_number(optarg, "power_of_two", POWER_OF_TWO_LIMIT, POWER_OF_TWO_MAX);
+			break;
+		case 'n':
+			if(n_flag != 0){
+				(void) usage();
 			}
-			if(endptr == optarg){ bail_out(EXIT_FAILURE, "parsing of power_of_two failed! (strtol) No digits were found."); }
-			/* strtol() parsed a number! */
-
-			if(*endptr != '\0'){
-				bail_out(EXIT_FAILURE, "Further characters after <power_of_two>: %s", endptr);
+			n_flag = 1;
+			shards = parse_number(optarg, "shards", 1, SHARDS_MAX);
+			break;
+		case 't':
+			if(t_flag != 0){
+				(void) usage();
 			}
-
-			/* check for valid id range */
-			if(p_arg < POWER_OF_TWO_LIMIT || p_arg	> POWER_OF_TWO_MAX){
-				bail_out(EXIT_FAILURE, "Use a valid power_of_two range (%d-%d)",POWER_OF_TWO_LIMIT,POWER_OF_TWO_MAX);
+			t_flag = 1;
+			*workers = parse_number(optarg, "workers", 1, WORKERS_MAX);
+			break;
+		case 'f':
+			if(f_flag != 0){
+				(void) usage();
 			}
-
-			*power_of_two = p_arg;
+			f_flag = 1;
+			*path = optarg;
+			break;
+		case 's':
+			if(s_flag != 0){
+				(void) usage();
+			}
+			s_flag = 1;
+			seed = parse_number(optarg, "seed", 0, LONG_MAX);
+			break;
+		case 'j':
+			if(j_flag != 0){
+				(void) usage();
+			}
+			j_flag = 1;
+			*journal_path = optarg;
 			break;
 		case '?':
 			usage();
@@ -214,76 +784,13 @@ static void parse_args(int argc, char **argv, unsigned int *power_of_two)
 	if(optind < argc){
 		(void) usage();
 	}
-
-	DEBUG("Parsing Arguments finished.\nPower of Two: %d\n",*power_of_two);
-}
-
-static void close_game( void )
-{
-	DEBUG("Clean Close of game %s\n",program_name);
-
-    if (semrm(s1) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore 1 (semrm)");
-    }
-    if (semrm(s2) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore 2 (semrm)");
-    }
-    if (semrm(s3) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore 3 (semrm)");
-    }
-    if (semrm(s4) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore 4 (semrm)");
-    }
-
-    // Remove shm game
-    if (shmctl(shm_id_game, IPC_RMID, NULL) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error terminating shared memory of game (shmctl)");
-    }
-
-    exit(EXIT_SUCCESS);
-
-}
-
-static void pause_game (void)
-{
-	DEBUG("Clean Pause of game %s\n",program_name);
-
-	if (semrm(s1) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore 1 (semrm)");
-    }
-    if (semrm(s2) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore 2 (semrm)");
-    }
-    if (semrm(s3) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore 3 (semrm)");
-    }
-    if (semrm(s4) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore 4 (semrm)");
-    }
-
-    	// Remove shm game
-	if (shmdt(server) < 0) {
-		(void) bail_out(EXIT_FAILURE,"Error detaching shared memory of server (shmdt)");
-	}
-
-	exit(EXIT_SUCCESS);
-}
-
-static void reconnect_to_game (key_t key)
-{
-	DEBUG("Reconnect to game %d \n",key);
-
-	shm_id_game = shmget(SHM_KEY+key, sizeof(struct shared_game), PERMISSION);
-	if (shm_id_game < 0) {
-		(void) bail_out(EXIT_FAILURE,"Could not access the shared memory! Is there a online server?");
-	}
-	game = shmat(shm_id_game, NULL, 0);
-	if (game == (struct shared_game *) -1) {
-		(void) bail_out(EXIT_FAILURE,"shmat failed (game)");
+	if(shards * (*workers + 1) > STATS_THREADS){
+		(void) bail_out(EXIT_FAILURE,"%u shards with %ld workers each need more than %d threads", shards, *workers, STATS_THREADS);
 	}
 
-	(void) init_semaphors(key);
-
+	seed_random(&seeds, seed);
+	DEBUG("Parsing Arguments finished.\nPower of Two: %d Shards: %u Workers: %ld File: %s Seed: %llu\n",
+		power_of_two,shards,*workers,*path,(unsigned long long) seed);
 }
 
 /**
@@ -292,64 +799,53 @@ static void reconnect_to_game (key_t key)
  * @param argc The argument counter
  * @param argv The argument vector
  * @return EXIT_SUCCESS on success, EXIT_FAILURE in case of an error
- * @details global variables: program_name, server, game, s1, s2, s3, s4, sem_client, sem_client2
+ * @details global variables: program_name, server, arena, shard, stop_signals, stop_signal
 */
 int main(int argc, char ** argv) {
-	unsigned int power_of_two;
-	bool running = true;
-	(void) parse_args(argc, argv, &power_of_two);
-	(void) setup_signal_handler();
+	long workers;
+	const char *path;
+	const char *journal_path;
+	(void) parse_args(argc, argv, &workers, &path, &journal_path);
+	//the shards and all threads inherit the blocked signals, only wait_signal takes them
+	(void) sigemptyset(&stop_signals);
+	(void) sigaddset(&stop_signals, SIGINT);
+	(void) sigaddset(&stop_signals, SIGQUIT);
+	(void) sigaddset(&stop_signals, SIGTERM);
+	(void) pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+	(void) init_gamelogic();
 	(void) init_shared_memory();
-	do{
-		DEBUG("PARENT IS WAITING FOR CHILDS TO CONNECT\n");
-		//fork program when the client unlocks the semaphore
-		MY_P(sem_client,"sem_client");
-		pid_t pid = fork();
-		//from here the program is seperated into two programms
-			switch (pid) {
-			case -1:
-				(void) bail_out(EXIT_FAILURE,"can't fork");
-				break;
-			case 0:
-				/* start child */
-				srand(time(NULL));
-				if(server->id == ID_UNSET){
-					server->number_clients = server->number_clients + 1;
-					server->id = server->number_clients;
-					(void) init_shared_game(server->id);
-				} else{
-					(void) reconnect_to_game(server->id);
-				}
-					
-				MY_V(sem_client2,"sem_client2");
-
-				DEBUG("Starting Loop\n");
-				do {
-					DEBUG("\tREADY\n");
-					MY_P(s1,"s1");
-					unsigned int cmd = game->command;
-					unsigned int status = move_numbers_field(game->field,cmd,power_of_two);
-					DEBUG("Got:\t%d\n", cmd);
-					MY_V(s2,"s2");
-					game->status = status;
-					MY_V(s3,"s3");
-					MY_P(s4,"s4");
-					if(status == ST_DELETE 
-						|| status == ST_WON 
-						|| status == ST_LOST){
-						(void) close_game();
-					}
-					if(status == ST_HALT)
-					{
-
-						(void) pause_game();
-					}
-
-				} while (running);
-				break;
-			default:
-				//parent process
-				break;
-			}
-	} while(running);
-}
\ No newline at end of file
+	(void) init_stats(workers);
+	(void) init_arena(path);
+	if(journal_path != NULL){
+		journal = open(journal_path, O_WRONLY | O_CREAT | O_APPEND, PERMISSION);
+		if(journal < 0){
+			(void) bail_out(EXIT_FAILURE,"can't open journal %s", journal_path);
+		}
+	}
+	free_games = free_server_games;
+	(void) start_shards();
+
+	for(long i = 0; i < workers; ++i){
+		int error = pthread_create(&worker_threads[i], NULL, run_worker, main_counters + i + 1);
+		if(error != 0){
+			errno = error;
+			(void) bail_out(EXIT_FAILURE,"can't create worker thread");
+		}
+		++worker_count;
+	}
+	pthread_t signal_thread;
+	int error = pthread_create(&signal_thread, NULL, wait_signal, NULL);
+	if(error != 0){
+		errno = error;
+		(void) bail_out(EXIT_FAILURE,"can't create signal thread");
+	}
+
+	while(__atomic_load_n(&stop_signal, __ATOMIC_ACQUIRE) == 0){
+		DEBUG("SERVER IS WAITING FOR CLIENTS TO CONNECT\n");
+		(void) answer_registration();
+	}
+	//the workers are joined, the games deleted and the arena written back here and not in a signal handler
+	DEBUG("Caught Signal: %u\n",stop_signal);
+	(void) free_resources();
+	exit(EXIT_FAILURE);
+}
@@ -0,0 +1,294 @@
+/**
+ * @file 2048-sim.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This tool plays 2048 games with random moves directly on the game logic to measure its throughput. It does not need a 2048-server
+ * @date 19.10.2026
+ */
+
+#include "gamelogic.h"
+#include "batch.h"
+#include "shared.h"
+#include <limits.h>
+#include <assert.h>
+#include <time.h>
+
+/* === CONSTANTS === */
+
+/**
+ * @brief the default number of games to play
+ */
+#define GAMES_DEFAULT		(100000)
+
+/* === TYPE DEFINITIONS === */
+
+/**
+ * @brief the results of the played games
+ */
+struct results
+{
+	/**
+	 * @brief the number of moves of all games
+	 */
+	unsigned long moves;
+	/**
+	 * @brief the number of won games
+	 */
+	long wins;
+	/**
+	 * @brief the number of games for every power of two of the largest tile
+	 */
+	long max_tiles[16];
+	/**
+	 * @brief the number of games for every number of tiles at the end
+	 */
+	long tile_counts[FIELD_SIZE_X * FIELD_SIZE_Y + 1];
+};
+
+/* === PROTOTYPES === */
+
+/**
+ * mandatory usage function
+ * @brief This function prints the usage information (SYNOPSIS) onto stderr
+ * @details uses global variable: program_name
+ */
+static void usage(void);
+
+/**
+ * @brief Parse command line options
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @param games the number of games to play
+ * @param seed the seed of the random numbers
+ * @param power_of_two the power of two to win
+ * @param batched true to play the games in batches with move_batch
+ */
+static void parse_args(int argc, char **argv, long *games, unsigned int *seed, unsigned int *power_of_two, bool *batched);
+
+/**
+ * @brief plays one game with random moves
+ * @details a random direction is tried first, the other directions follow in order until a tile moves
+ * @param power_of_two the power of two to win
+ * @param moves incremented by the number of moves of the game
+ * @param field the field at the end of the game
+ * @param rng the random numbers of the moves and tiles
+ * @return ST_WON or ST_LOST
+ */
+static unsigned int play_game(unsigned int power_of_two, unsigned long *moves, bitboard *field, rng_state *rng);
+
+/**
+ * @brief counts a finished game
+ * @param results the results
+ * @param status ST_WON or ST_LOST
+ * @param field the field at the end of the game
+ */
+static void count_game(struct results *results, unsigned int status, bitboard field);
+
+/**
+ * @brief plays the games with random moves in batches of BATCH_BOARDS boards
+ * @details all boards of a batch make the same random move in every round. A game is lost once its tiles did not move in any
+ * of the four directions since its last move. A finished game is replaced by the next one. Every game has random tiles of its
+ * own from the seed and its number
+ * @param games the number of games to play
+ * @param seed the seed of the random moves and tiles
+ * @param power_of_two the power of two to win
+ * @param results the results
+ */
+static void play_batches(long games, unsigned int seed, unsigned int power_of_two, struct results *results);
+
+/* === IMPLEMENTATIONS === */
+
+static void usage(void)
+{
+	bail_out(EXIT_FAILURE, "USAGE: 2048-sim [-b] [-n games] [-s seed] [-p power_of_two]\n"
+	"\t-b:\tPlay the games in batches with the SIMD move engine\n"
+	"\t-n:\tNumber of games to play (default: 100000)\n"
+	"\t-s:\tSeed of the random moves and tiles (default: 1)\n"
+	"\t-p:\tPlay until 2^power_of_two is reached (default: 11)\n");
+}
+
+static void parse_args(int argc, char **argv, long *games, unsigned int *seed, unsigned int *power_of_two, bool *batched)
+{
+	int getopt_result;
+
+	*games = GAMES_DEFAULT;
+	*seed = 1;
+	*power_of_two = POWER_OF_TWO_DEFAULT;
+	*batched = false;
+
+	if(argc > 0) {
+		program_name = argv[0];
+	}
+
+	while ((getopt_result = getopt(argc, argv, "bn:s:p:")) != -1) {
+		switch (getopt_result) {
+		case 'b':
+			*batched = true;
+			break;
+		case 'n':
+			*games = parse_number(optarg, "games", 1, LONG_MAX);
+			break;
+		case 's':
+			*seed = parse_number(optarg, "seed", 0, UINT_MAX);
+			break;
+		case 'p':
+			*power_of_two = parse_number(optarg, "power_of_two", POWER_OF_TWO_LIMIT, POWER_OF_TWO_MAX);
+			break;
+		case '?':
+			usage();
+			break;
+		default:
+			assert(0);
+		}
+	}
+
+	if(optind < argc){
+		(void) usage();
+	}
+
+	DEBUG("Parsing Arguments finished.\nGames: %ld Seed: %u Power of Two: %u\n",
+		*games, *seed, *power_of_two);
+}
+
+static unsigned int play_game(unsigned int power_of_two, unsigned long *moves, bitboard *field, rng_state *rng)
+{
+	unsigned int status = ST_ON;
+
+	new_game(field, rng);
+	while(status == ST_ON){
+		unsigned int first = random_below(rng, 4);
+		status = ST_NOSUCHGAME;
+		for(unsigned int i = 0; i < 4 && status == ST_NOSUCHGAME; ++i){
+			status = move_numbers_field(field, (first + i) % 4, power_of_two, rng);
+		}
+		if(status == ST_NOSUCHGAME){
+			return ST_LOST;
+		}
+		++*moves;
+	}
+	return status;
+}
+
+static void count_game(struct results *results, unsigned int status, bitboard field)
+{
+	unsigned int max_tile = 0;
+	int tiles = 0;
+
+	if(status == ST_WON){
+		++results->wins;
+	}
+	for(int y = 0; y < FIELD_SIZE_Y; ++y){
+		for(int x = 0; x < FIELD_SIZE_X; ++x){
+			if(BOARD_TILE(field,x,y) > max_tile){
+				max_tile = BOARD_TILE(field,x,y);
+			}
+			if(BOARD_TILE(field,x,y) != 0){
+				++tiles;
+			}
+		}
+	}
+	++results->max_tiles[max_tile];
+	++results->tile_counts[tiles];
+}
+
+static void play_batches(long games, unsigned int seed, unsigned int power_of_two, struct results *results)
+{
+	static struct board_batch batch;
+	uint8_t tried[BATCH_BOARDS];
+	long started = 0;
+	long finished = 0;
+	rng_state rng;
+
+	seed_random(&rng, seed);
+	init_batch(&batch, games < BATCH_BOARDS ? games : BATCH_BOARDS);
+	for(unsigned int i = 0; i < batch.count; ++i){
+		new_batch_game(&batch, i, (uint64_t) seed << 32 | started++);
+		tried[i] = 0;
+	}
+
+	while(finished < games){
+		unsigned int command = random_below(&rng, 4);
+		results->moves += move_batch(&batch, command, power_of_two);
+
+		for(unsigned int i = 0; i < batch.count; ++i){
+			unsigned int status = batch.status[i];
+			if(batch.active[i] == 0){
+				continue;
+			}
+			//a board that did not move tries the other directions in the next rounds
+			if(status == ST_NOSUCHGAME){
+				tried[i] |= 1 << command;
+				if(tried[i] != 0xF){
+					continue;
+				}
+				status = ST_LOST;
+			} else{
+				tried[i] = 0;
+			}
+			if(status == ST_ON){
+				continue;
+			}
+			count_game(results, status, batch_to_bitboard(&batch, i));
+			++finished;
+			tried[i] = 0;
+			if(started < games){
+				new_batch_game(&batch, i, (uint64_t) seed << 32 | started++);
+			} else{
+				batch.active[i] = 0;
+			}
+		}
+	}
+}
+
+/**
+ * Program entry point
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE in case of an error
+ */
+int main(int argc, char ** argv) {
+	long games;
+	unsigned int seed;
+	unsigned int power_of_two;
+	bool batched;
+	struct results results;
+	struct timespec start;
+	struct timespec end;
+	rng_state rng;
+
+	(void) parse_args(argc, argv, &games, &seed, &power_of_two, &batched);
+
+	init_gamelogic();
+	seed_random(&rng, seed);
+	memset(&results, 0, sizeof(results));
+	
+	(void) clock_gettime(CLOCK_MONOTONIC, &start);
+	if(batched){
+		play_batches(games, seed, power_of_two, &results);
+	} else{
+		for(long i = 0; i < games; ++i){
+			bitboard field;
+			unsigned int status = play_game(power_of_two, &results.moves, &field, &rng);
+			count_game(&results, status, field);
+		}
+	}
+	(void) clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("games:   %ld (%.0f games/s)\n", games, games / seconds);
+	printf("won:     %ld (%.3f%%)\n", results.wins, 100.0 * results.wins / games);
+	printf("moves:   %lu (%.0f moves/s, %.1f per game)\n", results.moves, results.moves / seconds, (double) results.moves / games);
+	printf("time:    %.3f s\n", seconds);
+	for(int power = 1; power < COUNT_OF(results.max_tiles); ++power){
+		if(results.max_tiles[power] > 0){
+			printf("max %5u: %ld\n", 1u << power, results.max_tiles[power]);
+		}
+	}
+	for(int tiles = 0; tiles < COUNT_OF(results.tile_counts); ++tiles){
+		if(results.tile_counts[tiles] > 0){
+			printf("tiles %3d: %ld\n", tiles, results.tile_counts[tiles]);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
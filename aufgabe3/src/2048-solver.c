@@ -0,0 +1,181 @@
+/**
+ * @file 2048-solver.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This tool plays 2048 games with the expectimax solver and reports how well it played. It does not need a 2048-server
+ * @date 19.10.2026
+ */
+
+#include "solver.h"
+#include "shared.h"
+#include <limits.h>
+#include <assert.h>
+#include <time.h>
+
+/* === CONSTANTS === */
+
+/**
+ * @brief the default number of games to play
+ */
+#define GAMES_DEFAULT		(10)
+
+/* === PROTOTYPES === */
+
+/**
+ * mandatory usage function
+ * @brief This function prints the usage information (SYNOPSIS) onto stderr
+ * @details uses global variable: program_name
+ */
+static void usage(void);
+
+/**
+ * @brief Parse command line options
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @param games the number of games to play
+ * @param depth the search depth of the solver
+ * @param seed the seed of the random numbers
+ * @param power_of_two the power of two to win
+ */
+static void parse_args(int argc, char **argv, long *games, int *depth, unsigned int *seed, unsigned int *power_of_two);
+
+/**
+ * @brief plays one game with the solver
+ * @param depth the search depth of the solver
+ * @param power_of_two the power of two to win
+ * @param moves incremented by the number of moves of the game
+ * @param field the field at the end of the game
+ * @param rng the random numbers of the tiles
+ * @return ST_WON or ST_LOST
+ */
+static unsigned int play_game(int depth, unsigned int power_of_two, unsigned long *moves, bitboard *field, rng_state *rng);
+
+/* === IMPLEMENTATIONS === */
+
+static void usage(void)
+{
+	bail_out(EXIT_FAILURE, "USAGE: 2048-solver [-n games] [-d depth] [-s seed] [-p power_of_two]\n"
+	"\t-n:\tNumber of games to play (default: 10)\n"
+	"\t-d:\tNumber of moves the solver looks ahead (default: 3)\n"
+	"\t-s:\tSeed of the random tiles (default: 1)\n"
+	"\t-p:\tPlay until 2^power_of_two is reached (default: 11)\n");
+}
+
+static void parse_args(int argc, char **argv, long *games, int *depth, unsigned int *seed, unsigned int *power_of_two)
+{
+	int getopt_result;
+
+	*games = GAMES_DEFAULT;
+	*depth = SOLVER_DEFAULT_DEPTH;
+	*seed = 1;
+	*power_of_two = POWER_OF_TWO_DEFAULT;
+
+	if(argc > 0) {
+		program_name = argv[0];
+	}
+
+	while ((getopt_result = getopt(argc, argv, "n:d:s:p:")) != -1) {
+		switch (getopt_result) {
+		case 'n':
+			*games = parse_number(optarg, "games", 1, LONG_MAX);
+			break;
+		case 'd':
+			*depth = parse_number(optarg, "depth", 1, SOLVER_MAX_DEPTH);
+			break;
+		case 's':
+			*seed = parse_number(optarg, "seed", 0, UINT_MAX);
+			break;
+		case 'p':
+			*power_of_two = parse_number(optarg, "power_of_two", POWER_OF_TWO_LIMIT, POWER_OF_TWO_MAX);
+			break;
+		case '?':
+			usage();
+			break;
+		default:
+			assert(0);
+		}
+	}
+
+	if(optind < argc){
+		(void) usage();
+	}
+
+	DEBUG("Parsing Arguments finished.\nGames: %ld Depth: %d Seed: %u Power of Two: %u\n",
+		*games, *depth, *seed, *power_of_two);
+}
+
+static unsigned int play_game(int depth, unsigned int power_of_two, unsigned long *moves, bitboard *field, rng_state *rng)
+{
+	unsigned int status = ST_ON;
+
+	new_game(field, rng);
+	while(status == ST_ON){
+		int command = best_move(*field, depth);
+		if(command < 0){
+			return ST_LOST;
+		}
+		status = move_numbers_field(field, command, power_of_two, rng);
+		++*moves;
+	}
+	return status;
+}
+
+/**
+ * Program entry point
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE in case of an error
+ */
+int main(int argc, char ** argv) {
+	long games;
+	int depth;
+	unsigned int seed;
+	unsigned int power_of_two;
+	unsigned long moves = 0;
+	long wins = 0;
+	long max_tiles[16] = { 0 };
+	struct timespec start;
+	struct timespec end;
+	rng_state rng;
+
+	(void) parse_args(argc, argv, &games, &depth, &seed, &power_of_two);
+
+	if(init_solver() < 0){
+		bail_out(EXIT_FAILURE, "init_solver");
+	}
+	seed_random(&rng, seed);
+	
+	(void) clock_gettime(CLOCK_MONOTONIC, &start);
+	for(long i = 0; i < games; ++i){
+		bitboard field;
+		unsigned int max_tile = 0;
+
+		if(play_game(depth, power_of_two, &moves, &field, &rng) == ST_WON){
+			++wins;
+		}
+		for(int y = 0; y < FIELD_SIZE_Y; ++y){
+			for(int x = 0; x < FIELD_SIZE_X; ++x){
+				if(BOARD_TILE(field,x,y) > max_tile){
+					max_tile = BOARD_TILE(field,x,y);
+				}
+			}
+		}
+		++max_tiles[max_tile];
+		DEBUG("game %ld: max tile %u\n", i + 1, 1u << max_tile);
+	}
+	(void) clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	printf("games:   %ld\n", games);
+	printf("won:     %ld (%.1f%%)\n", wins, 100.0 * wins / games);
+	printf("moves:   %lu (%.0f moves/s)\n", moves, moves / seconds);
+	printf("time:    %.3f s\n", seconds);
+	for(int power = 1; power < COUNT_OF(max_tiles); ++power){
+		if(max_tiles[power] > 0){
+			printf("max %5u: %ld\n", 1u << power, max_tiles[power]);
+		}
+	}
+
+	free_solver();
+	return EXIT_SUCCESS;
+}
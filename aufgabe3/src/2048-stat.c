@@ -0,0 +1,291 @@
+/**
+ * @file 2048-stat.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief This tool shows the statistics of a running 2048-server like vmstat
+ * @details the first line shows the averages since the start of the server, every further line the ones of the last delay
+ * @date 19.10.2026
+ */
+
+#include "shared.h"
+#include <limits.h>
+#include <assert.h>
+
+/* === CONSTANTS === */
+
+/**
+ * @brief the header of the lines of the statistics
+ */
+#define HEADER	" active paused    new resumed  won lost deleted refused  moves/s wait% hs50us hs99us\n"
+
+/* === TYPE DEFINITIONS === */
+
+/**
+ * @brief the statistics of all threads at one point in time
+ */
+struct snapshot
+{
+	/**
+	 * @brief the time of the snapshot, from monotonic_ns
+	 */
+	uint64_t time;
+	/**
+	 * @brief the counters summed over all threads
+	 */
+	struct stats_counters sum;
+	/**
+	 * @brief the histogram of the handshake latencies
+	 */
+	uint64_t handshakes[STATS_LATENCY_BUCKETS];
+};
+
+/* === GLOBALS === */
+
+/**
+ * @brief the shared memory of the statistics
+ */
+static int shm_id = -1;
+
+/**
+ * @brief the statistics of the server
+ */
+static const struct shared_stats *stats;
+
+/* === PROTOTYPES === */
+
+/**
+ * mandatory usage function
+ * @brief This function prints the usage information (SYNOPSIS) onto stderr
+ * @details uses global variable: program_name
+ */
+static void usage(void);
+
+/**
+ * @brief Parse command line options
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @param delay the seconds between two lines, 0 for a single line
+ * @param count the number of lines, 0 for no limit
+ * @param histogram true to print the histogram of the handshake latencies
+ */
+static void parse_args(int argc, char **argv, long *delay, long *count, bool *histogram);
+
+/**
+ * @brief attaches the statistics read-only
+ * @details shm_id, stats
+ */
+static void attach_stats(void);
+
+/**
+ * @brief sums the counters of all threads
+ * @param snap the snapshot
+ * @details stats
+ */
+static void take_snapshot(struct snapshot *snap);
+
+/**
+ * @brief finds a percentile of the handshake latencies between two snapshots
+ * @param old the older snapshot
+ * @param now the newer snapshot
+ * @param percent the percentile
+ * @return the upper bound of the bucket of the percentile in microseconds, -1 if there were no handshakes
+ */
+static long latency_percentile(const struct snapshot *old, const struct snapshot *now, int percent);
+
+/**
+ * @brief prints one line of statistics
+ * @param old the older snapshot
+ * @param now the newer snapshot
+ * @details stats
+ */
+static void print_line(const struct snapshot *old, const struct snapshot *now);
+
+/**
+ * @brief prints the histogram of the handshake latencies since the start of the server
+ * @param now the snapshot
+ */
+static void print_histogram(const struct snapshot *now);
+
+/* === IMPLEMENTATIONS === */
+
+static void usage(void)
+{
+	bail_out(EXIT_FAILURE, "USAGE: 2048-stat [-l] [delay [count]]\n"
+	"\t-l:\tPrint the histogram of the handshake latencies\n"
+	"\tdelay:\tSeconds between two lines (default: one line)\n"
+	"\tcount:\tNumber of lines (default: no limit)\n");
+}
+
+static void parse_args(int argc, char **argv, long *delay, long *count, bool *histogram)
+{
+	int getopt_result;
+
+	*delay = 0;
+	*count = 0;
+	*histogram = false;
+
+	if(argc > 0) {
+		program_name = argv[0];
+	}
+
+	while ((getopt_result = getopt(argc, argv, "l")) != -1) {
+		switch (getopt_result) {
+		case 'l':
+			*histogram = true;
+			break;
+		case '?':
+			usage();
+			break;
+		default:
+			assert(0);
+		}
+	}
+
+	if(optind < argc){
+		*delay = parse_number(argv[optind++], "delay", 1, INT_MAX);
+	}
+	if(optind < argc){
+		*count = parse_number(argv[optind++], "count", 1, LONG_MAX);
+	}
+	if(optind < argc){
+		(void) usage();
+	}
+}
+
+static void attach_stats(void)
+{
+	shm_id = shmget(STATS_KEY, sizeof(struct shared_stats), 0);
+	if (shm_id < 0) {
+		(void) bail_out(EXIT_FAILURE,"Could not access the statistics! Is there a online server?");
+	}
+	stats = shmat(shm_id, NULL, SHM_RDONLY);
+	if (stats == (struct shared_stats*) -1) {
+		(void) bail_out(EXIT_FAILURE,"shmat failed (stats)");
+	}
+}
+
+static void take_snapshot(struct snapshot *snap)
+{
+	uint64_t *sum = (uint64_t *) &snap->sum;
+
+	memset(snap, 0, sizeof(*snap));
+	snap->time = monotonic_ns();
+	//the counters are read one by one, a line may miss the moves of a game that ended at the same time
+	for(int thread = 0; thread < STATS_THREADS; ++thread){
+		const uint64_t *counters = (const uint64_t *) &stats->threads[thread];
+		for(size_t i = 0; i < sizeof(struct stats_counters) / sizeof(uint64_t); ++i){
+			sum[i] += __atomic_load_n(&counters[i], __ATOMIC_RELAXED);
+		}
+		//an idle worker would show no wait until it gets work
+		uint64_t since = __atomic_load_n(&stats->threads[thread].wait_since, __ATOMIC_RELAXED);
+		if(since != 0 && since < snap->time){
+			snap->sum.wait_ns += snap->time - since;
+		}
+	}
+	snap->sum.wait_since = 0;
+	for(int bucket = 0; bucket < STATS_LATENCY_BUCKETS; ++bucket){
+		snap->handshakes[bucket] = __atomic_load_n(&stats->handshakes[bucket], __ATOMIC_RELAXED);
+	}
+}
+
+static long latency_percentile(const struct snapshot *old, const struct snapshot *now, int percent)
+{
+	uint64_t total = 0;
+	uint64_t seen = 0;
+
+	for(int bucket = 0; bucket < STATS_LATENCY_BUCKETS; ++bucket){
+		total += now->handshakes[bucket] - old->handshakes[bucket];
+	}
+	if(total == 0){
+		return -1;
+	}
+	for(int bucket = 0; bucket < STATS_LATENCY_BUCKETS; ++bucket){
+		seen += now->handshakes[bucket] - old->handshakes[bucket];
+		if(seen * 100 >= total * percent){
+			return 1L << bucket;
+		}
+	}
+	return 1L << (STATS_LATENCY_BUCKETS - 1);
+}
+
+static void print_line(const struct snapshot *old, const struct snapshot *now)
+{
+	const struct stats_counters *sum = &now->sum;
+	double seconds = (now->time - old->time) / 1e9;
+	long hs50 = latency_percentile(old, now, 50);
+	long hs99 = latency_percentile(old, now, 99);
+
+	printf("%7lld %6lld %6llu %7llu %4llu %4llu %7llu %7llu %8.0f %5.1f",
+		(long long) (sum->created + sum->resumed - sum->paused - sum->won - sum->lost - sum->deleted),
+		(long long) (stats->paused_start + sum->paused - sum->resumed),
+		(unsigned long long) (sum->created - old->sum.created),
+		(unsigned long long) (sum->resumed - old->sum.resumed),
+		(unsigned long long) (sum->won - old->sum.won),
+		(unsigned long long) (sum->lost - old->sum.lost),
+		(unsigned long long) (sum->deleted - old->sum.deleted),
+		(unsigned long long) (sum->refused - old->sum.refused),
+		seconds > 0 ? (sum->moves - old->sum.moves) / seconds : 0,
+		seconds > 0 ? (sum->wait_ns - old->sum.wait_ns) / (seconds * 1e7 * stats->workers) : 0);
+	if(hs50 < 0){
+		printf(" %6s %6s\n", "-", "-");
+	} else{
+		printf(" %6ld %6ld\n", hs50, hs99);
+	}
+	(void) fflush(stdout);
+}
+
+static void print_histogram(const struct snapshot *now)
+{
+	printf("handshakes below\n");
+	for(int bucket = 0; bucket < STATS_LATENCY_BUCKETS; ++bucket){
+		if(now->handshakes[bucket] == 0){
+			continue;
+		}
+		if(bucket == STATS_LATENCY_BUCKETS - 1){
+			printf("%9s %12llu\n", "more", (unsigned long long) now->handshakes[bucket]);
+		} else{
+			printf("%7ldus %12llu\n", 1L << bucket, (unsigned long long) now->handshakes[bucket]);
+		}
+	}
+}
+
+/**
+ * Program entry point
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE in case of an error
+ * @details global variables: program_name, shm_id, stats
+ */
+int main(int argc, char ** argv) {
+	long delay;
+	long count;
+	bool histogram;
+	struct snapshot old;
+	struct snapshot now;
+
+	(void) parse_args(argc, argv, &delay, &count, &histogram);
+	(void) attach_stats();
+
+	//the first line covers the time since the start of the server
+	memset(&old, 0, sizeof(old));
+	old.time = stats->started;
+	take_snapshot(&now);
+	if(histogram){
+		print_histogram(&now);
+		return EXIT_SUCCESS;
+	}
+
+	(void) fputs(HEADER, stdout);
+	print_line(&old, &now);
+	for(long line = 1; delay > 0 && (count == 0 || line < count); ++line){
+		(void) sleep(delay);
+		//a new server has a new segment, this one keeps the last numbers of the old server
+		if(shmget(STATS_KEY, sizeof(struct shared_stats), 0) != shm_id){
+			(void) bail_out(EXIT_FAILURE,"The server is gone");
+		}
+		old = now;
+		take_snapshot(&now);
+		print_line(&old, &now);
+	}
+	return EXIT_SUCCESS;
+}
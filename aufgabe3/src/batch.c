@@ -0,0 +1,267 @@
+/**
+ * @file batch.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief The implementation of the batched game logic
+ * @date 19.10.2026
+ */
+
+#include "batch.h"
+#include <string.h>
+#include <immintrin.h>
+
+/* === TYPE DEFINITIONS === */
+
+/**
+ * @brief the same tile of BATCH_LANES boards
+ * @details the operators of the vector extension of gcc work on all lanes at once, a compare yields -1 in every lane where it holds
+ */
+typedef uint8_t byte_vector __attribute__((vector_size(BATCH_LANES)));
+
+/**
+ * @brief a byte_vector at any address of the boards of a batch
+ */
+typedef uint8_t batch_lanes __attribute__((vector_size(BATCH_LANES), aligned(1), may_alias));
+
+/* === MACROS === */
+
+/**
+ * @def BLEND(mask,x,y)
+ * @brief selects the lanes of x where the mask is 0xFF and the lanes of y where it is 0
+ * @details one pblendvb with AVX2 or SSE4.1, a macro, a function with vector arguments would depend on the ABI of -mavx2
+ */
+#if defined(__AVX2__)
+#define BLEND(mask,x,y) ((byte_vector) _mm256_blendv_epi8((__m256i) (y), (__m256i) (x), (__m256i) (mask)))
+#elif defined(__SSE4_1__)
+#define BLEND(mask,x,y) ((byte_vector) _mm_blendv_epi8((__m128i) (y), (__m128i) (x), (__m128i) (mask)))
+#else
+#define BLEND(mask,x,y) (((mask) & (x)) | (~(mask) & (y)))
+#endif
+
+/**
+ * @def LANE_MASK(v)
+ * @brief gathers the highest bit of every lane of a vector into bit lane of the result
+ */
+#ifdef __AVX2__
+#define LANE_MASK(v) ((uint32_t) _mm256_movemask_epi8((__m256i) (v)))
+#else
+#define LANE_MASK(v) ((uint32_t) _mm_movemask_epi8((__m128i) (v)))
+#endif
+
+/* === PROTOTYPES === */
+
+/**
+ * @brief moves one line of four tiles of every board like the row tables of gamelogic
+ * @details the tiles are pushed to the front, then the pairs are merged from the front like move_tile does it.
+ * A move to the right packs the line to the back afterwards. A move to the left of a line like 0 x x x or x 0 x x
+ * leaves the merged tile behind the unmerged one, move_tile does so, too
+ * @param line the four tiles of the line, line[0] is the left or the upper one
+ * @param right true to move to the right or down
+ */
+static void move_line(byte_vector *line[4], bool right);
+
+/**
+ * @brief copies a bitboard into a board of a batch
+ * @param batch the batch
+ * @param index the index of the board
+ * @param board the bitboard
+ */
+static void store_bitboard(struct board_batch *batch, unsigned int index, bitboard board);
+
+/* === IMPLEMENTATIONS === */
+
+static void move_line(byte_vector *line[4], bool right)
+{
+	byte_vector a = *line[0];
+	byte_vector b = *line[1];
+	byte_vector c = *line[2];
+	byte_vector d = *line[3];
+	byte_vector m;
+	byte_vector swap = (byte_vector) {0};
+
+	if(!right){
+		swap = (byte_vector) (d == c) & ~(byte_vector) (c == 0)
+			& (((byte_vector) (a == 0) & (byte_vector) (b == c)) | ((byte_vector) (b == 0) & (byte_vector) (a == c)));
+	}
+
+	//push the tiles to the front
+	m = (byte_vector) (c == 0);
+	c = BLEND(m, d, c);
+	d &= ~m;
+	m = (byte_vector) (b == 0);
+	b = BLEND(m, c, b);
+	c = BLEND(m, d, c);
+	d &= ~m;
+	m = (byte_vector) (a == 0);
+	a = BLEND(m, b, a);
+	b = BLEND(m, c, b);
+	c = BLEND(m, d, c);
+	d &= ~m;
+
+	//merge the pairs, a tile of 2^15 stays one like in move_row
+	m = (byte_vector) (a == b) & ~(byte_vector) (a == 0);
+	a -= m & (byte_vector) (a != 0xF);
+	b = BLEND(m, c, b);
+	c = BLEND(m, d, c);
+	d &= ~m;
+	m = (byte_vector) (b == c) & ~(byte_vector) (b == 0);
+	b -= m & (byte_vector) (b != 0xF);
+	c = BLEND(m, d, c);
+	d &= ~m;
+	m = (byte_vector) (c == d) & ~(byte_vector) (c == 0);
+	c -= m & (byte_vector) (c != 0xF);
+	d &= ~m;
+
+	if(right){
+		for(int i = 0; i < 3; ++i){
+			m = (byte_vector) (d == 0);
+			d = BLEND(m, c, d);
+			c = BLEND(m, b, c);
+			b = BLEND(m, a, b);
+			a &= ~m;
+		}
+	} else{
+		m = BLEND(swap, b, a);
+		b = BLEND(swap, a, b);
+		a = m;
+	}
+
+	*line[0] = a;
+	*line[1] = b;
+	*line[2] = c;
+	*line[3] = d;
+}
+
+static void store_bitboard(struct board_batch *batch, unsigned int index, bitboard board)
+{
+	for(int t = 0; t < BATCH_TILES; ++t){
+		batch->tiles[t][index] = (board >> (4 * t)) & 0xF;
+	}
+}
+
+void init_batch(struct board_batch *batch, unsigned int count)
+{
+	memset(batch, 0, sizeof(*batch));
+	batch->count = count;
+}
+
+void new_batch_game(struct board_batch *batch, unsigned int index, uint64_t seed)
+{
+	bitboard board;
+
+	seed_random(&batch->rng[index], seed);
+	new_game(&board, &batch->rng[index]);
+	store_bitboard(batch, index, board);
+	batch->active[index] = 1;
+	batch->status[index] = ST_ON;
+}
+
+unsigned int move_batch(struct board_batch *batch, unsigned int command, unsigned int power_of_two)
+{
+	static const uint8_t lines[4][4][4] = {
+		[CMD_LEFT] = { { 0, 1, 2, 3 }, { 4, 5, 6, 7 }, { 8, 9, 10, 11 }, { 12, 13, 14, 15 } },
+		[CMD_RIGHT] = { { 0, 1, 2, 3 }, { 4, 5, 6, 7 }, { 8, 9, 10, 11 }, { 12, 13, 14, 15 } },
+		[CMD_UP] = { { 0, 4, 8, 12 }, { 1, 5, 9, 13 }, { 2, 6, 10, 14 }, { 3, 7, 11, 15 } },
+		[CMD_DOWN] = { { 0, 4, 8, 12 }, { 1, 5, 9, 13 }, { 2, 6, 10, 14 }, { 3, 7, 11, 15 } },
+	};
+	unsigned int moved_boards = 0;
+	//the tiles can not hold more than 2^15, so no tile matches a larger power
+	const uint8_t power = power_of_two > 0xF ? 0xFF : power_of_two;
+
+	if(command > CMD_DOWN){
+		return 0;
+	}
+
+	for(unsigned int base = 0; base < batch->count; base += BATCH_LANES){
+		byte_vector old[BATCH_TILES];
+		byte_vector tiles[BATCH_TILES];
+		byte_vector active;
+		byte_vector status;
+		byte_vector moved = (byte_vector) {0};
+		byte_vector won = (byte_vector) {0};
+		byte_vector empty_count = (byte_vector) {0};
+		byte_vector seen = (byte_vector) {0};
+		byte_vector pick;
+		byte_vector power_of_new;
+		uint8_t counts[BATCH_LANES];
+		uint8_t picks[BATCH_LANES];
+		uint8_t powers[BATCH_LANES];
+
+		active = (byte_vector) (*(const batch_lanes *) &batch->active[base] != 0);
+		//the boards behind count are left alone
+		if(batch->count - base < BATCH_LANES){
+			for(unsigned int lane = batch->count - base; lane < BATCH_LANES; ++lane){
+				active[lane] = 0;
+			}
+		}
+		if(LANE_MASK(active) == 0){
+			continue;
+		}
+		for(int t = 0; t < BATCH_TILES; ++t){
+			tiles[t] = *(const batch_lanes *) &batch->tiles[t][base];
+			old[t] = tiles[t];
+		}
+
+		for(int i = 0; i < 4; ++i){
+			byte_vector *line[4];
+			for(int j = 0; j < 4; ++j){
+				line[j] = &tiles[lines[command][i][j]];
+			}
+			move_line(line, command == CMD_RIGHT || command == CMD_DOWN);
+		}
+
+		for(int t = 0; t < BATCH_TILES; ++t){
+			tiles[t] = BLEND(active, tiles[t], old[t]);
+			moved |= tiles[t] ^ old[t];
+			won |= (byte_vector) (tiles[t] == power);
+			//a compare yields -1, so this counts the empty tiles
+			empty_count -= (byte_vector) (tiles[t] == 0);
+		}
+
+		moved = (byte_vector) (moved != 0);
+		//the status before the new tiles, a board without an empty tile is set to ST_LOST below
+		status = *(const batch_lanes *) &batch->status[base];
+		won &= moved;
+		status = BLEND(active & ~moved, (byte_vector) {0} + ST_NOSUCHGAME, status);
+		status = BLEND(moved & ~won, (byte_vector) {0} + ST_ON, status);
+		status = BLEND(won, (byte_vector) {0} + ST_WON, status);
+		*(batch_lanes *) &batch->status[base] = status;
+		moved_boards += __builtin_popcount(LANE_MASK(moved));
+
+		//the random numbers are drawn board by board in the order of new_number_field, a lane without a new tile picks no tile
+		memcpy(counts, &empty_count, sizeof(counts));
+		memset(picks, 0xFF, sizeof(picks));
+		memset(powers, 0, sizeof(powers));
+		for(uint32_t lanes = LANE_MASK(moved & ~won); lanes != 0; lanes &= lanes - 1){
+			unsigned int lane = __builtin_ctz(lanes);
+			if(counts[lane] == 0){
+				DEBUG("NO FIELDS LEFT!\n");
+				batch->status[base + lane] = ST_LOST;
+				continue;
+			}
+			picks[lane] = random_below(&batch->rng[base + lane], counts[lane]);
+			powers[lane] = random_below(&batch->rng[base + lane], 4) < 3 ? 1 : 2;
+		}
+
+		//the new tile goes to the empty tile with pick empty tiles before it, like select_bit picks it
+		memcpy(&pick, picks, sizeof(pick));
+		memcpy(&power_of_new, powers, sizeof(power_of_new));
+		for(int t = 0; t < BATCH_TILES; ++t){
+			byte_vector empty = (byte_vector) (tiles[t] == 0);
+			tiles[t] = BLEND(empty & (byte_vector) (seen == pick), power_of_new, tiles[t]);
+			seen -= empty;
+			*(batch_lanes *) &batch->tiles[t][base] = tiles[t];
+		}
+	}
+
+	return moved_boards;
+}
+
+bitboard batch_to_bitboard(const struct board_batch *batch, unsigned int index)
+{
+	bitboard board = 0;
+
+	for(int t = 0; t < BATCH_TILES; ++t){
+		board |= (bitboard) batch->tiles[t][index] << (4 * t);
+	}
+	return board;
+}
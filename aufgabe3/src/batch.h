@@ -0,0 +1,107 @@
+/**
+ * @file batch.h
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief The header file of the batched game logic: many 4x4 boards that make the same move in lockstep
+ * @details the boards are stored as struct of arrays, one byte per tile and board, so that one vector holds the same tile of
+ * BATCH_LANES boards. The moves follow the row tables of gamelogic exactly: a board of a batch plays the same game as a
+ * bitboard with the same seed and moves
+ * @date 19.10.2026
+ */
+
+#ifndef dp_batch_h /*prevent multible inclusion*/
+#define dp_batch_h
+
+#include "gamelogic.h"
+
+/* === CONSTANTS === */
+
+/**
+ * @def BATCH_LANES
+ * @brief The number of boards that are moved with one vector operation, one byte per board in an AVX2 (use -mavx2) or SSE2 register
+ */
+#ifdef __AVX2__
+#define BATCH_LANES			(32)
+#else
+#define BATCH_LANES			(16)
+#endif
+
+/**
+ * @def BATCH_BOARDS
+ * @brief The maximum number of boards of a batch, a multiple of BATCH_LANES
+ */
+#define BATCH_BOARDS		(256)
+
+/**
+ * @def BATCH_TILES
+ * @brief The number of tiles of a board of a batch
+ */
+#define BATCH_TILES			(FIELD_SIZE_X * FIELD_SIZE_Y)
+
+/* === TYPE DEFINITIONS === */
+
+/**
+ * @brief many boards of FIELD_SIZE_X x FIELD_SIZE_Y tiles
+ */
+struct board_batch
+{
+	/**
+	 * @brief tiles[FIELD_SIZE_X * y + x][i] is the power of two of the tile (x,y) of board i, 0 if it is empty
+	 */
+	uint8_t tiles[BATCH_TILES][BATCH_BOARDS];
+	/**
+	 * @brief 0 to leave a board out of the next moves
+	 */
+	uint8_t active[BATCH_BOARDS];
+	/**
+	 * @brief the status of the last move of every board, like move_numbers_field returns it
+	 */
+	uint8_t status[BATCH_BOARDS];
+	/**
+	 * @brief the random numbers of the new tiles of every board
+	 */
+	rng_state rng[BATCH_BOARDS];
+	/**
+	 * @brief the number of boards
+	 */
+	unsigned int count;
+};
+
+/* === PROTOTYPES === */
+
+/**
+ * @brief empties a batch
+ * @param batch the batch
+ * @param count the number of boards {1,...,BATCH_BOARDS}, they are all inactive
+ */
+void init_batch(struct board_batch *batch, unsigned int count);
+
+/**
+ * @brief starts a new game on a board of a batch, like seed_random and new_game
+ * @param batch the batch
+ * @param index the index of the board
+ * @param seed the seed of the random numbers of the board
+ */
+void new_batch_game(struct board_batch *batch, unsigned int index, uint64_t seed);
+
+/**
+ * @brief moves all active boards of a batch by the same command
+ * @details the tiles are moved with vector compares and blends, up and down move the columns instead of the rows, so no board
+ * is transposed. The new tiles are placed with vector compares too, only their random numbers are drawn one board after the
+ * other. The status of every active board is set like
+ * move_numbers_field returns it, the status of the other boards is kept
+ * @param batch the batch
+ * @param command CMD_LEFT, CMD_RIGHT, CMD_UP or CMD_DOWN
+ * @param power_of_two the challange to win
+ * @return the number of boards that moved
+ */
+unsigned int move_batch(struct board_batch *batch, unsigned int command, unsigned int power_of_two);
+
+/**
+ * @brief converts a board of a batch to a bitboard
+ * @param batch the batch
+ * @param index the index of the board
+ * @return the bitboard with the same tiles
+ */
+bitboard batch_to_bitboard(const struct board_batch *batch, unsigned int index);
+
+#endif /*ifndef dp_batch_h*/
@@ -81,6 +81,29 @@
     */
  #define ST_HALT 		(5)
 
+/* === GATEWAY PROTOCOL === */
+
+/**
+ * @def GATEWAY_PORT_DEFAULT
+ * @brief The default TCP port of the 2048-gateway
+ */
+#define GATEWAY_PORT_DEFAULT	(2048)
+/**
+ * @def GATEWAY_HELLO_SIZE
+ * @brief The size of the first message of a TCP client: width, height and the id of a paused game in network byte order,
+ * id 0 starts a new game of that size. Every following byte is one CMD_LEFT up to CMD_DISCONNECT, closing the connection pauses the game. After a shutdown of
+ * the sending side the frames of the sent commands still arrive before the game is paused
+ */
+#define GATEWAY_HELLO_SIZE		(4)
+/**
+ * @def GATEWAY_FRAME_HEADER
+ * @brief The size of the header of a frame of the gateway: status, width, height and the id in network byte order.
+ * The width * height powers of two of the tiles follow row by row. The hello is answered with ST_ON, or with ST_NOSUCHGAME
+ * and no tiles if the game can not be opened, and every command with its status. The gateway closes the connection after
+ * ST_WON, ST_LOST, ST_DELETE and ST_HALT
+ */
+#define GATEWAY_FRAME_HEADER	(5)
+
 /* === GAME LOGIC CONSTANTS  === */
     
 /**
@@ -93,19 +116,64 @@
   * @brief The size of the field in y axis
   */
 #define FIELD_SIZE_Y			(4)
+/**
+ * @def FIELD_SIZE_MIN
+ * @brief The smallest width and height of a board
+ */
+#define FIELD_SIZE_MIN			(3)
+/**
+ * @def FIELD_SIZE_MAX
+ * @brief The largest width and height of a board
+ */
+#define FIELD_SIZE_MAX			(8)
+
+/**
+ * @brief the game field as bitboard
+ * @details every tile takes 4 bits that hold the power of two of its value (0 = empty).
+ * The tile (x,y) is stored in the bits 4*(FIELD_SIZE_X*y + x) up to 4*(FIELD_SIZE_X*y + x) + 3,
+ * so every row is one 16 bit word
+ */
+typedef uint64_t bitboard;
 
 /**
- * @brief the tile of a field
+ * @brief the state of the random numbers of one game
+ * @details a game with its own state plays the same tiles for the same seed, no matter which other games run
  */
-struct tile{
+typedef uint64_t rng_state;
+
+/**
+ * @def BOARD_TILE(board,x,y)
+ * @brief The power of two of the tile (x,y) of a bitboard, 0 if the tile is empty
+ */
+#define BOARD_TILE(board,x,y) \
+	((unsigned int) (((board) >> (4 * (FIELD_SIZE_X * (y) + (x)))) & 0xF))
+
+/**
+ * @brief a game field of any size from FIELD_SIZE_MIN x FIELD_SIZE_MIN up to FIELD_SIZE_MAX x FIELD_SIZE_MAX
+ * @details the tiles are stored like in a bitboard with 4 bits per tile, but every row has a 32 bit word of its own.
+ * The tiles behind the width and the rows behind the height are 0
+ */
+struct board
+{
+	/**
+	 * @brief the number of tiles of a row
+	 */
+	uint8_t width;
 	/**
-	 * @brief the value of the tile
+	 * @brief the number of rows
 	 */
-	uint8_t val;
+	uint8_t height;
 	/**
-	 * @brief indicates if the tile has been merged in this round
+	 * @brief the tile (x,y) is stored in the bits 4*x up to 4*x + 3 of rows[y]
 	 */
-	bool has_merged;
+	uint32_t rows[FIELD_SIZE_MAX];
 };
 
+/**
+ * @def FIELD_TILE(field,x,y)
+ * @brief The power of two of the tile (x,y) of a struct board, 0 if the tile is empty
+ */
+#define FIELD_TILE(field,x,y) \
+	((unsigned int) (((field).rows[(y)] >> (4 * (x))) & 0xF))
+
 #endif /*ifndef dp_commands_h*/
@@ -6,210 +6,484 @@
  */
 
 #include "gamelogic.h"
+#include <string.h>
 
 /* === PROTOTYPES === */
 
 /**
- * @brief move the tile of the field to the specified direction if possible
- * @param field the field to get updated
- * @param x the x coordinate of the tile to move
- * @param y the y coordinate of the tile to move
- * @param dir the direction to move
- * @param has_moved if a tile moves it gets true
+ * @brief move the tile of a line to the specified direction if possible
+ * @details this is the move of a single tile that the row tables are built from
+ * @param line the tiles of the line
+ * @param merged indicates for every tile if it has been merged in this round
+ * @param i the index of the tile to move
+ * @param dir the direction to move {-1,1}
+ * @param width the number of tiles of the line
  */
-static void move(struct tile field[FIELD_SIZE_Y][FIELD_SIZE_X], 
-	int x, int y, struct direction dir, bool *has_moved);
+static void move_tile(uint8_t line[FIELD_SIZE_MAX], bool merged[FIELD_SIZE_MAX], int i, int dir, int width);
 
 /**
- * @brief this function returns true if the coordinates are in the field
- * @param x the x coordinate of the tile
- * @param y the y coordinate of the tile
- * @return true if the coordinates are in the field
+ * @brief this function returns true if the index is in the line
+ * @param i the index of the tile
+ * @param width the number of tiles of the line
+ * @return true if the index is in the line
  */
-static bool is_in_field(int x, int y);
+static bool is_in_line(int i, int width);
 
 /**
  * @brief adds a new tile on a free tile on the field
  * @param field the field that need a new random tile
+ * @param rng the random numbers of the game
  * @return ST_LOST if no fields are left to add a new tile or ST_ON if everything went well
  */
-static unsigned int new_number_field(struct tile field[FIELD_SIZE_Y][FIELD_SIZE_X]);
+static unsigned int new_number_field(bitboard *field, rng_state *rng);
 
-/* === CONSTANTS === */
+/**
+ * @brief adds a new tile on a free tile of a board of any size
+ * @param field the board that needs a new random tile
+ * @param rng the random numbers of the game
+ * @return ST_LOST if no tiles are left to add a new tile or ST_ON if everything went well
+ */
+static unsigned int new_number_board(struct board *field, rng_state *rng);
+
+/* === TYPE DEFINITIONS === */
 
 /**
- * @brief direction to move a tile up
+ * @brief the move kernels of one row width
  */
- const static struct direction up 		= {0,-1};
+struct row_kernel
+{
+	/**
+	 * @brief moves a row to the left
+	 */
+	uint32_t (*left)(uint32_t row);
+	/**
+	 * @brief moves a row to the right
+	 */
+	uint32_t (*right)(uint32_t row);
+};
+
+/* === GLOBALS === */
+
 /**
- * @brief direction to move a tile down
+ * @brief the result of a move to the left for every row
  */
- const static struct direction down 	= {0,1};
+static uint16_t row_left[ROW_TABLE_SIZE];
+
 /**
- * @brief direction to move a tile left
+ * @brief the result of a move to the right for every row
  */
- const static struct direction left 	= {-1,0};
+static uint16_t row_right[ROW_TABLE_SIZE];
+
 /**
- * @brief direction to move a tile right
+ * @brief true once the row tables are built
  */
- const static struct direction right 	= {1,0};
+static bool tables_ready = false;
 
 /* === IMPLEMENTATIONS === */
 
-static unsigned int new_number_field(struct tile field[FIELD_SIZE_Y][FIELD_SIZE_X])
-{
-    int number_zero_fields = 0;
-    for(int y = 0; y < FIELD_SIZE_Y; ++y){
-        for(int x = 0; x < FIELD_SIZE_X; ++x){
-            if(field[y][x].val == 0){
-                ++number_zero_fields;
-            }
-        }
-    }
-    if(number_zero_fields == 0){
-    	//Error
-    	return ST_LOST;
-    	DEBUG("NO FIELDS LEFT!\n");
-    } else{
-	    int r = rand() % number_zero_fields + 1;
-	    int power = 2;
-	    if((rand() % 4) < 3){
-	        power = 1;
-	    }
-	    for(int y = 0; y < FIELD_SIZE_Y; ++y){
-	        for(int x = 0; x < FIELD_SIZE_X; ++x){
-	            if(field[y][x].val == 0){
-	                if(--r==0){
-	                    field[y][x].val = power;
-	                }
-	            }
-	        }
-	    }
-	}
-
-	return ST_ON;
-}
-
-static bool is_in_field(int x, int y)
+static bool is_in_line(int i, int width)
 {
-	return (x >= 0 && x < FIELD_SIZE_X 
-		&& y >= 0 && y < FIELD_SIZE_Y);
+	return (i >= 0 && i < width);
 }
 
-static void move(struct tile field[FIELD_SIZE_Y][FIELD_SIZE_X], 
-	int x, int y, struct direction dir, bool *has_moved)
+static void move_tile(uint8_t line[FIELD_SIZE_MAX], bool merged[FIELD_SIZE_MAX], int i, int dir, int width)
 {
-	int start_x = x;
-	int start_y = y;
-	if(field[y][x].val == 0) {
+	int start = i;
+	if(line[i] == 0) {
 		return;
 	}
 
 	//get next available tile
 	do{
-		x += dir.x;
-		y += dir.y;
-	} while(is_in_field(x,y)
-		&& field[y][x].val == 0);
-	x -= dir.x;
-	y -= dir.y;
-	
-
-	if(x != start_x || y != start_y)
+		i += dir;
+	} while(is_in_line(i, width) && line[i] == 0);
+	i -= dir;
+
+	if(i != start)
 	{
 		//move tile to next available tile
-		DEBUG("MOVE FIELD (%d,%d) TO (%d,%d)\n",start_x,start_y,x,y);
-		field[y][x].val = field[start_y][start_x].val;
-		field[y][x].has_merged = field[start_y][start_x].has_merged;
-		field[start_y][start_x].val = 0;
-		field[start_y][start_x].has_merged = false;
-		*has_moved = true;
-		if(is_in_field(start_x-dir.x,start_y-dir.y)){
-			move(field,start_x-dir.x,start_y-dir.y,dir,has_moved);
+		line[i] = line[start];
+		merged[i] = merged[start];
+		line[start] = 0;
+		merged[start] = false;
+		if(is_in_line(start-dir, width)){
+			move_tile(line,merged,start-dir,dir,width);
 		}
 	}
 	//merge
-	if(is_in_field(x+dir.x,y+dir.y)
-	 && field[y][x].val == field[y+dir.y][x+dir.x].val
-	 && field[y+dir.y][x+dir.x].has_merged == false
-	 && field[y][x].has_merged == false)
+	if(is_in_line(i+dir, width)
+	 && line[i] == line[i+dir]
+	 && merged[i+dir] == false
+	 && merged[i] == false)
 	{
-		DEBUG("MERGE FIELD (%d,%d) TO (%d,%d)\n",x,y,y+dir.y,x+dir.x);
-		field[y][x].val = 0;
-		field[y+dir.y][x+dir.x].val++;
-		field[y+dir.y][x+dir.x].has_merged = true;
-		*has_moved = true;
-		if(is_in_field(x-dir.x,y-dir.y)){
-			move(field,x-dir.x,y-dir.y,dir,has_moved);
+		line[i] = 0;
+		line[i+dir]++;
+		merged[i+dir] = true;
+		if(is_in_line(i-dir, width)){
+			move_tile(line,merged,i-dir,dir,width);
 		}
 	}
 }
 
-void new_game(struct tile field[FIELD_SIZE_Y][FIELD_SIZE_X])
+/**
+ * @brief calculates the result of a move of one row
+ * @details rows wider than the row tables are moved with this directly
+ * @param row the row, 4 bits per tile
+ * @param width the number of tiles of the row
+ * @param dir the direction to move {-1,1}
+ * @return the moved row
+ */
+static inline uint32_t move_row(uint32_t row, int width, int dir)
 {
+	uint8_t line[FIELD_SIZE_MAX];
+	bool merged[FIELD_SIZE_MAX] = { false };
+	uint32_t result = 0;
+
+	for(int x = 0; x < width; ++x){
+		line[x] = (row >> (4 * x)) & 0xF;
+	}
+	for(int x = 0; x < width; ++x){
+		move_tile(line,merged,x,dir,width);
+	}
+	for(int x = 0; x < width; ++x){
+		//a tile of 2^16 can not be stored, the game is won long before
+		result |= (uint32_t) (line[x] > 0xF ? 0xF : line[x]) << (4 * x);
+	}
+	return result;
+}
+
+/**
+ * @brief moves all four rows of a board with a row table
+ * @param board the board
+ * @param table row_left or row_right
+ * @return the moved board
+ */
+static bitboard move_rows(bitboard board, const uint16_t table[ROW_TABLE_SIZE])
+{
+	return (bitboard) table[board & 0xFFFF]
+		| (bitboard) table[(board >> 16) & 0xFFFF] << 16
+		| (bitboard) table[(board >> 32) & 0xFFFF] << 32
+		| (bitboard) table[(board >> 48) & 0xFFFF] << 48;
+}
+
+bitboard transpose_board(bitboard board)
+{
+	bitboard a1 = board & 0xF0F00F0FF0F00F0FULL;
+	bitboard a2 = board & 0x0000F0F00000F0F0ULL;
+	bitboard a3 = board & 0x0F0F00000F0F0000ULL;
+	bitboard a = a1 | (a2 << 12) | (a3 >> 12);
+	bitboard b1 = a & 0xFF00FF0000FF00FFULL;
+	bitboard b2 = a & 0x00FF00FF00000000ULL;
+	bitboard b3 = a & 0x00000000FF00FF00ULL;
+	return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+bitboard empty_tiles(bitboard board)
+{
+	board |= board >> 2;
+	board |= board >> 1;
+	return ~board & 0x1111111111111111ULL;
+}
+
+/**
+ * @brief checks if a board has a tile with the given power of two
+ * @param board the board
+ * @param power the power of two {1,...,15}
+ * @return true if one of the tiles has the value 2^power
+ */
+static bool has_tile(bitboard board, unsigned int power)
+{
+	//tiles with the searched power become 0
+	board ^= 0x1111111111111111ULL * power;
+	return ((board - 0x1111111111111111ULL) & ~board & 0x8888888888888888ULL) != 0;
+}
+
+static unsigned int new_number_field(bitboard *field, rng_state *rng)
+{
+	bitboard empty = empty_tiles(*field);
+	int number_zero_fields = __builtin_popcountll(empty);
+	if(number_zero_fields == 0){
+		DEBUG("NO FIELDS LEFT!\n");
+		return ST_LOST;
+	}
+
+	bitboard tile = select_bit(empty, random_below(rng, number_zero_fields));
+	bitboard power = random_below(rng, 4) < 3 ? 1 : 2;
+	*field |= power * tile;
+
+	return ST_ON;
+}
+
+/* rows of up to four tiles fit into the row tables, a row of three is moved right in the upper tiles */
+static uint32_t move_row_left_3(uint32_t row) { return row_left[row]; }
+static uint32_t move_row_right_3(uint32_t row) { return row_right[row << 4] >> 4; }
+static uint32_t move_row_left_4(uint32_t row) { return row_left[row]; }
+static uint32_t move_row_right_4(uint32_t row) { return row_right[row]; }
+
+/**
+ * @brief the move kernels indexed by the width of the row
+ * @details only rows of up to four tiles have a kernel, wider rows are moved with move_row
+ */
+static const struct row_kernel row_kernels[FIELD_SIZE_MAX + 1] = {
+	[3] = { move_row_left_3, move_row_right_3 },
+	[4] = { move_row_left_4, move_row_right_4 },
+};
+
+/**
+ * @brief swaps rows and columns of the tiles of a board of any size
+ * @param rows the rows of the tiles
+ * @param columns the rows of the transposed tiles
+ * @param width the number of tiles of a row
+ * @param height the number of rows
+ */
+static void transpose_rows(const uint32_t *rows, uint32_t *columns, int width, int height)
+{
+	for(int x = 0; x < width; ++x){
+		uint32_t column = 0;
+		for(int y = 0; y < height; ++y){
+			column |= ((rows[y] >> (4 * x)) & 0xF) << (4 * y);
+		}
+		columns[x] = column;
+	}
+}
+
+/**
+ * @brief moves every row of a board with the kernel of its width
+ * @param rows the rows
+ * @param count the number of rows
+ * @param width the number of tiles of a row
+ * @param dir the direction to move {-1,1}
+ */
+static void move_rows_with(uint32_t *rows, int count, int width, int dir)
+{
+	uint32_t (*kernel)(uint32_t row) = dir < 0 ? row_kernels[width].left : row_kernels[width].right;
+
+	for(int i = 0; i < count; ++i){
+		rows[i] = kernel != NULL ? kernel(rows[i]) : move_row(rows[i], width, dir);
+	}
+}
+
+/**
+ * @brief moves the tiles of a board of any size without adding a new tile
+ * @details up and down move the rows of the transposed board with the kernel of the height
+ * @param field the board
+ * @param command CMD_LEFT, CMD_RIGHT, CMD_UP or CMD_DOWN
+ */
+static void move_sized_board(struct board *field, unsigned int command)
+{
+	uint32_t columns[FIELD_SIZE_MAX];
+
+	switch(command){
+		case CMD_LEFT:
+			move_rows_with(field->rows, field->height, field->width, -1);
+			break;
+		case CMD_RIGHT:
+			move_rows_with(field->rows, field->height, field->width, 1);
+			break;
+		case CMD_UP:
+		case CMD_DOWN:
+			transpose_rows(field->rows, columns, field->width, field->height);
+			move_rows_with(columns, field->width, field->height, command == CMD_UP ? -1 : 1);
+			transpose_rows(columns, field->rows, field->height, field->width);
+			break;
+	}
+}
+
+static unsigned int new_number_board(struct board *field, rng_state *rng)
+{
+	uint32_t empty[FIELD_SIZE_MAX];
+	int number_zero_fields = 0;
+	//the lowest bit of every empty tile of the width
+	const uint32_t tiles = 0x11111111u >> (4 * (FIELD_SIZE_MAX - field->width));
+
+	for(int y = 0; y < field->height; ++y){
+		uint32_t row = field->rows[y];
+		row |= row >> 2;
+		row |= row >> 1;
+		empty[y] = ~row & tiles;
+		number_zero_fields += __builtin_popcount(empty[y]);
+	}
+	if(number_zero_fields == 0){
+		DEBUG("NO FIELDS LEFT!\n");
+		return ST_LOST;
+	}
+
+	unsigned int r = random_below(rng, number_zero_fields);
+	int y = 0;
+	while(r >= (unsigned int) __builtin_popcount(empty[y])){
+		r -= __builtin_popcount(empty[y++]);
+	}
+	uint32_t tile = select_bit(empty[y], r);
+	uint32_t power = random_below(rng, 4) < 3 ? 1 : 2;
+	field->rows[y] |= power * tile;
+
+	return ST_ON;
+}
+
+void seed_random(rng_state *rng, uint64_t seed)
+{
+	*rng = 0;
+	(void) next_random(rng);
+	*rng += seed;
+	(void) next_random(rng);
+}
+
+uint32_t next_random(rng_state *rng)
+{
+	uint64_t old = *rng;
+	*rng = old * 6364136223846793005ULL + 1442695040888963407ULL;
+	uint32_t xorshifted = ((old >> 18) ^ old) >> 27;
+	uint32_t rotation = old >> 59;
+	return (xorshifted >> rotation) | (xorshifted << ((-rotation) & 31));
+}
+
+uint32_t random_below(rng_state *rng, uint32_t bound)
+{
+	//the upper half of the product, the bias is below bound / 2^32
+	return ((uint64_t) next_random(rng) * bound) >> 32;
+}
+
+void init_gamelogic(void)
+{
+	if(tables_ready){
+		return;
+	}
+	for(uint32_t row = 0; row < ROW_TABLE_SIZE; ++row){
+		row_left[row] = move_row(row, FIELD_SIZE_X, -1);
+		row_right[row] = move_row(row, FIELD_SIZE_X, 1);
+	}
+	tables_ready = true;
+}
+
+bitboard move_board(bitboard board, unsigned int command)
+{
+	if(!tables_ready){
+		init_gamelogic();
+	}
+	switch(command){
+		case CMD_LEFT:
+			return move_rows(board, row_left);
+		case CMD_RIGHT:
+			return move_rows(board, row_right);
+		case CMD_UP:
+			return transpose_board(move_rows(transpose_board(board), row_left));
+		case CMD_DOWN:
+			return transpose_board(move_rows(transpose_board(board), row_right));
+		default:
+			return board;
+	}
+}
+
+void new_game(bitboard *field, rng_state *rng)
+{
+	*field = 0;
+	new_number_field(field, rng);
+}
+
+bitboard board_to_bitboard(const struct board *field)
+{
+	bitboard board = 0;
 	for(int y = 0; y < FIELD_SIZE_Y; ++y){
-        for(int x = 0; x < FIELD_SIZE_X; ++x){
-            field[y][x].val = 0;
-            field[y][x].has_merged = false;
-        }
-    }
+		board |= (bitboard) field->rows[y] << (4 * FIELD_SIZE_X * y);
+	}
+	return board;
+}
+
+void new_board(struct board *field, unsigned int width, unsigned int height, rng_state *rng)
+{
+	memset(field, 0, sizeof(*field));
+	field->width = width;
+	field->height = height;
+	new_number_board(field, rng);
+}
+
+unsigned int move_numbers_board(
+	struct board *field,
+	unsigned int command,
+	unsigned int power_of_two,
+	rng_state *rng)
+{
+	if(field->width == FIELD_SIZE_X && field->height == FIELD_SIZE_Y){
+		bitboard board = board_to_bitboard(field);
+		unsigned int status = move_numbers_field(&board, command, power_of_two, rng);
+		for(int y = 0; y < FIELD_SIZE_Y; ++y){
+			field->rows[y] = (board >> (4 * FIELD_SIZE_X * y)) & 0xFFFF;
+		}
+		return status;
+	}
+
+	switch(command){
+		case CMD_DELETE:
+		 	return ST_DELETE;
+		case CMD_DISCONNECT:
+		 	return ST_HALT;
+		case CMD_LEFT:
+		case CMD_RIGHT:
+		case CMD_UP:
+		case CMD_DOWN:
+			break;
+		default:
+			return ST_NOSUCHGAME;
+	}
+	if(!tables_ready){
+		init_gamelogic();
+	}
 
-    new_number_field(field);
+	struct board moved = *field;
+	move_sized_board(&moved, command);
+	if(memcmp(moved.rows, field->rows, sizeof(moved.rows)) == 0){
+		DEBUG("NO SUCH GAME!\n");
+		return ST_NOSUCHGAME;
+	}
+	*field = moved;
+
+	for(int y = 0; y < field->height; ++y){
+		//tiles with the searched power become 0, the tiles behind the width do not
+		uint32_t row = field->rows[y] ^ (0x11111111u * power_of_two);
+		if(((row - 0x11111111u) & ~row & 0x88888888u) != 0){
+			return ST_WON;
+		}
+	}
+
+	return new_number_board(field, rng);
 }
 
 unsigned int move_numbers_field(
-	struct tile field[FIELD_SIZE_Y][FIELD_SIZE_X], 
-	unsigned int command, 
-	unsigned int power_of_two)
+	bitboard *field,
+	unsigned int command,
+	unsigned int power_of_two,
+	rng_state *rng)
 {
-	struct direction dir;
 	switch(command){
-		case CMD_LEFT:	
+		case CMD_LEFT:
 			DEBUG("MOVE LEFT!\n");
-			dir = left;
 			break;
-		case CMD_RIGHT:	
+		case CMD_RIGHT:
 			DEBUG("MOVE RIGHT!\n");
-			dir = right;
 			break;
-		case CMD_UP:	
+		case CMD_UP:
 			DEBUG("MOVE UP!\n");
-			dir = up;
 			break;
-		case CMD_DOWN:	
+		case CMD_DOWN:
 			DEBUG("MOVE DOWN!\n");
-			dir = down;
-			break;		
+			break;
 		case CMD_DELETE:
 		 	return ST_DELETE;
-		case CMD_DISCONNECT:	
-		 	return ST_HALT;	
+		case CMD_DISCONNECT:
+		 	return ST_HALT;
 	}
 
-	bool has_moved = false;
+	bitboard moved = move_board(*field, command);
 
-	for(int y = 0; y < FIELD_SIZE_Y; ++y){
-        for(int x = 0; x < FIELD_SIZE_X; ++x){
-            move(field,x,y,dir,&has_moved);
-        }
-    }
-
-    if(has_moved == false){
-    	DEBUG("NO SUCH GAME!\n");
-    	return ST_NOSUCHGAME;
-    }
-
-
-    for(int y = 0; y < FIELD_SIZE_Y; ++y){
-        for(int x = 0; x < FIELD_SIZE_X; ++x){
-        	//reset merges
-        	field[y][x].has_merged = false;
-        	//check for win
-            if(field[y][x].val == power_of_two){
-            	return ST_WON;
-            }
-        }
-    }
-
-    return new_number_field(field);
-}
\ No newline at end of file
+	if(moved == *field){
+		DEBUG("NO SUCH GAME!\n");
+		return ST_NOSUCHGAME;
+	}
+	*field = moved;
+
+	if(has_tile(moved, power_of_two)){
+		return ST_WON;
+	}
+
+	return new_number_field(field, rng);
+}
@@ -5,12 +5,15 @@
  * @date 29.04.2014
  */
 
-#ifndef dp_gamelogic_h /*prevent multible inclusion*/ 
+#ifndef dp_gamelogic_h /*prevent multible inclusion*/
 #define dp_gamelogic_h
 
 #include "commands.h"
 #include <stdlib.h>
 #include <stdio.h>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
 
 /* === MACROS === */
 
@@ -27,37 +30,136 @@
 /* === DEFS === */
 
 /**
- * @brief a struct that encapsulates the direction of a move
+ * @def ROW_TABLE_SIZE
+ * @brief The number of entries of a row move table, one for every possible row of 16 bits
+ */
+#define ROW_TABLE_SIZE			(1 << 16)
+
+/* === INLINE FUNCTIONS === */
+
+/**
+ * @brief selects a set bit of a mask
+ * @details one pdep instruction with BMI2, otherwise the lower set bits are cleared one by one
+ * @param mask the mask
+ * @param n the number of set bits below the selected one {0,...,popcount(mask)-1}
+ * @return the mask with only the selected bit set
  */
- struct direction{
- 	/**
- 	 * @brief x {-1,0,1}
- 	 */
- 	int x;
- 	/**
- 	 * @brief y {-1,0,1}
- 	 */
- 	int y;
- };
+static inline uint64_t select_bit(uint64_t mask, unsigned int n)
+{
+#ifdef __BMI2__
+	return _pdep_u64(1ULL << n, mask);
+#else
+	while(n-- > 0){
+		mask &= mask - 1;
+	}
+	return mask & -mask;
+#endif
+}
 
 /* === PROTOTYPES === */
 
+/**
+ * @brief sets the state of the random numbers of a game
+ * @param rng the state
+ * @param seed the seed, the same seed gives the same numbers
+ */
+void seed_random(rng_state *rng, uint64_t seed);
+
+/**
+ * @brief returns the next random number of a game
+ * @details PCG-XSH-RR: a 64 bit linear congruential generator with a permuted 32 bit output
+ * @param rng the state
+ * @return the random number
+ */
+uint32_t next_random(rng_state *rng);
+
+/**
+ * @brief returns a random number below a bound without a division
+ * @param rng the state
+ * @param bound the bound {1,...,2^32-1}
+ * @return the random number {0,...,bound-1}
+ */
+uint32_t random_below(rng_state *rng, uint32_t bound);
+
+/**
+ * @brief builds the row move tables
+ * @details the tables are built on first use too, but programs with threads have to call this before the threads start
+ */
+void init_gamelogic(void);
+
+/**
+ * @brief moves the tiles of a board without adding a new tile
+ * @details left and right cost four table lookups, up and down transpose the board before and after
+ * @param board the board to move
+ * @param command CMD_LEFT, CMD_RIGHT, CMD_UP or CMD_DOWN
+ * @return the moved board, equal to board if no tile can move
+ */
+bitboard move_board(bitboard board, unsigned int command);
+
+/**
+ * @brief swaps rows and columns of a board
+ * @param board the board
+ * @return the tile (x,y) of board is the tile (y,x) of the result
+ */
+bitboard transpose_board(bitboard board);
+
+/**
+ * @brief returns a mask with the lowest bit of every empty tile set
+ * @param board the board
+ * @return the bit 4*(FIELD_SIZE_X*y + x) is set if the tile (x,y) is empty
+ */
+bitboard empty_tiles(bitboard board);
+
 /**
  * @brief move the field by the given command
  * @param field the field to get updated
  * @param command the command that updates the field
  * @param power_of_two the challange to win
+ * @param rng the random numbers of the game for the new tile
  * @return the new game status
  */
 unsigned int move_numbers_field(
-	struct tile field[FIELD_SIZE_Y][FIELD_SIZE_X], 
-	unsigned int command, 
-	unsigned int power_of_two);
+	bitboard *field,
+	unsigned int command,
+	unsigned int power_of_two,
+	rng_state *rng);
 
 /**
  * @brief creats a new field
  * @param field the field that gets reset and one new random tile
+ * @param rng the random numbers of the game
+ */
+void new_game(bitboard *field, rng_state *rng);
+
+/**
+ * @brief converts a board of FIELD_SIZE_X x FIELD_SIZE_Y tiles to a bitboard
+ * @param field the board
+ * @return the bitboard with the same tiles
+ */
+bitboard board_to_bitboard(const struct board *field);
+
+/**
+ * @brief move a board of any size by the given command
+ * @details a FIELD_SIZE_X x FIELD_SIZE_Y board is moved as bitboard, other sizes use the row kernel of their width or height
+ * @param field the board to get updated
+ * @param command the command that updates the board
+ * @param power_of_two the challange to win
+ * @param rng the random numbers of the game for the new tile
+ * @return the new game status
+ */
+unsigned int move_numbers_board(
+	struct board *field,
+	unsigned int command,
+	unsigned int power_of_two,
+	rng_state *rng);
+
+/**
+ * @brief creats a new board with one random tile
+ * @param field the board that gets reset
+ * @param width the number of tiles of a row {FIELD_SIZE_MIN,...,FIELD_SIZE_MAX}
+ * @param height the number of rows {FIELD_SIZE_MIN,...,FIELD_SIZE_MAX}
+ * @param rng the random numbers of the game
  */
-void new_game(struct tile field[FIELD_SIZE_Y][FIELD_SIZE_X]);
+void new_board(struct board *field, unsigned int width, unsigned int height, rng_state *rng);
 
 #endif /*ifndef dp_gamelogic_h*/
@@ -0,0 +1,191 @@
+/**
+ * @file journal.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief The binary move journal of a 2048 server
+ * @details the records of a game are only written by the worker that handles the game, so the buffer needs no lock.
+ * The journal is opened with O_APPEND and every record is written with one write, so the records of the workers do not mix
+ * @date 19.10.2026
+ */
+
+#include "journal.h"
+#include "shared.h"
+
+/* === PROTOTYPES === */
+
+/**
+ * @brief writes a record with its payload with one write
+ * @param fd the journal
+ * @param record the header
+ * @param payload the payload
+ * @param size the size of the payload
+ */
+static void journal_write(int fd, const struct journal_record *record, const void *payload, size_t size);
+
+/**
+ * @brief fills the header of a record of a game
+ * @param record the header
+ * @param type the type of the record
+ * @param id the id of the game
+ * @param game the game
+ */
+static void journal_header(struct journal_record *record, uint8_t type, uint16_t id, const struct shared_game *game);
+
+/**
+ * @brief writes the state of a game
+ * @param fd the journal
+ * @param type JOURNAL_CHECKPOINT or JOURNAL_RESUME
+ * @param id the id of the game
+ * @param game the game
+ * @param power_of_two the power of two to win
+ */
+static void journal_state(int fd, uint8_t type, uint16_t id, const struct shared_game *game, unsigned int power_of_two);
+
+/**
+ * @brief writes the buffered moves of a game
+ * @param fd the journal
+ * @param id the id of the game
+ * @param game the game
+ */
+static void journal_flush(int fd, uint16_t id, struct shared_game *game);
+
+/* === IMPLEMENTATIONS === */
+
+static void journal_write(int fd, const struct journal_record *record, const void *payload, size_t size)
+{
+	uint8_t buffer[sizeof(*record) + sizeof(struct journal_checkpoint)];
+
+	(void) memcpy(buffer, record, sizeof(*record));
+	if(size > 0){
+		(void) memcpy(buffer + sizeof(*record), payload, size);
+	}
+	//a full disk must not stop the games
+	if(write(fd, buffer, sizeof(*record) + size) != (ssize_t) (sizeof(*record) + size)){
+		DEBUG("Journal write failed for game %d\n", record->id);
+	}
+}
+
+static void journal_header(struct journal_record *record, uint8_t type, uint16_t id, const struct shared_game *game)
+{
+	record->seed = game->seed;
+	record->id = id;
+	record->type = type;
+	record->detail = 0;
+	record->count = game->field.width | game->field.height << 8;
+	record->reserved = 0;
+}
+
+static void journal_state(int fd, uint8_t type, uint16_t id, const struct shared_game *game, unsigned int power_of_two)
+{
+	struct journal_record record;
+	struct journal_checkpoint checkpoint;
+
+	journal_header(&record, type, id, game);
+	record.detail = power_of_two;
+	checkpoint.moves = game->journal.moves;
+	checkpoint.rng = game->rng;
+	(void) memcpy(checkpoint.rows, game->field.rows, sizeof(checkpoint.rows));
+	journal_write(fd, &record, &checkpoint, sizeof(checkpoint));
+}
+
+static void journal_flush(int fd, uint16_t id, struct shared_game *game)
+{
+	struct journal_record record;
+
+	if(game->journal.pending == 0){
+		return;
+	}
+	journal_header(&record, JOURNAL_MOVES, id, game);
+	record.count = game->journal.pending;
+	journal_write(fd, &record, game->journal.packed, (game->journal.pending + 3) / 4);
+	game->journal.pending = 0;
+}
+
+void journal_start(int fd, uint16_t id, struct shared_game *game, unsigned int power_of_two)
+{
+	struct journal_record record;
+
+	game->journal.moves = 0;
+	game->journal.pending = 0;
+	if(fd < 0){
+		return;
+	}
+	journal_header(&record, JOURNAL_START, id, game);
+	record.detail = power_of_two;
+	journal_write(fd, &record, NULL, 0);
+}
+
+void journal_resume(int fd, uint16_t id, struct shared_game *game, unsigned int power_of_two)
+{
+	//moves of a server that did not shut down cleanly are lost with its buffer
+	game->journal.pending = 0;
+	if(fd < 0){
+		return;
+	}
+	journal_state(fd, JOURNAL_RESUME, id, game, power_of_two);
+}
+
+void journal_move(int fd, uint16_t id, struct shared_game *game, unsigned int command, unsigned int power_of_two)
+{
+	struct journal_buffer *buffer = &game->journal;
+
+	if(fd < 0){
+		return;
+	}
+	if(buffer->pending % 4 == 0){
+		buffer->packed[buffer->pending / 4] = 0;
+	}
+	buffer->packed[buffer->pending / 4] |= command << (2 * (buffer->pending % 4));
+	++buffer->pending;
+	++buffer->moves;
+	if(buffer->pending == JOURNAL_BLOCK_MOVES){
+		journal_flush(fd, id, game);
+		if(buffer->moves % JOURNAL_CHECKPOINT_MOVES == 0){
+			journal_state(fd, JOURNAL_CHECKPOINT, id, game, power_of_two);
+		}
+	}
+}
+
+void journal_end(int fd, uint16_t id, struct shared_game *game, unsigned int status)
+{
+	struct journal_record record;
+
+	if(fd < 0){
+		return;
+	}
+	journal_flush(fd, id, game);
+	journal_header(&record, JOURNAL_END, id, game);
+	record.detail = status;
+	journal_write(fd, &record, NULL, 0);
+}
+
+int journal_read(FILE *file, struct journal_record *record, uint8_t *payload)
+{
+	size_t size = 0;
+	size_t length = fread(record, 1, sizeof(*record), file);
+
+	if(length != sizeof(*record)){
+		//a record cut off by a crash of the server is not an end
+		return length == 0 && feof(file) ? 0 : -1;
+	}
+	switch(record->type){
+		case JOURNAL_START:
+		case JOURNAL_END:
+			break;
+		case JOURNAL_MOVES:
+			if(record->count == 0 || record->count > JOURNAL_BLOCK_MOVES){
+				return -1;
+			}
+			size = (record->count + 3) / 4;
+			break;
+		case JOURNAL_CHECKPOINT:
+		case JOURNAL_RESUME:
+			size = sizeof(struct journal_checkpoint);
+			break;
+		default:
+			return -1;
+	}
+	if(size > 0 && fread(payload, size, 1, file) != 1){
+		return -1;
+	}
+	return 1;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file journal.h
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief The header file of the binary move journal of a 2048 server
+ * @details the journal is a sequence of records. Every record is a struct journal_record that may be followed by a payload.
+ * The records of all games are interleaved, the seed tells the games apart. Numbers are stored in the byte order of the host
+ * @date 19.10.2026
+ */
+
+#ifndef dp_journal_h /*prevent multible inclusion*/
+#define dp_journal_h
+
+#include "commands.h"
+#include <stdio.h>
+
+/* === CONSTANTS === */
+
+/**
+ * @def JOURNAL_BLOCK_MOVES
+ * @brief The number of moves a game buffers before they are written as one record, a multiple of 4
+ */
+#define JOURNAL_BLOCK_MOVES		(128)
+
+/**
+ * @def JOURNAL_CHECKPOINT_MOVES
+ * @brief The number of moves between two checkpoints of a game, a multiple of JOURNAL_BLOCK_MOVES
+ */
+#define JOURNAL_CHECKPOINT_MOVES	(4096)
+
+/**
+ * @def JOURNAL_START
+ * @brief A new game: detail is the power of two to win, count the width in the low and the height in the high byte. No payload
+ */
+#define JOURNAL_START			(1)
+/**
+ * @def JOURNAL_MOVES
+ * @brief count moves with 2 bits each, the first move in the lowest bits of the first byte of the payload
+ */
+#define JOURNAL_MOVES			(2)
+/**
+ * @def JOURNAL_CHECKPOINT
+ * @brief The state of a game, like JOURNAL_START with a struct journal_checkpoint as payload
+ */
+#define JOURNAL_CHECKPOINT		(3)
+/**
+ * @def JOURNAL_RESUME
+ * @brief A paused game got a client again, like JOURNAL_CHECKPOINT
+ */
+#define JOURNAL_RESUME			(4)
+/**
+ * @def JOURNAL_END
+ * @brief The end of a game or a pause: detail is the last status. No payload
+ */
+#define JOURNAL_END				(5)
+
+/* === TYPE DEFINITIONS === */
+
+struct shared_game;
+
+/**
+ * @brief the header of every record of the journal, 16 bytes without padding
+ */
+struct journal_record
+{
+	/**
+	 * @brief the seed of the game
+	 */
+	uint64_t seed;
+	/**
+	 * @brief the id of the game when the record was written
+	 */
+	uint16_t id;
+	/**
+	 * @brief JOURNAL_START, JOURNAL_MOVES, JOURNAL_CHECKPOINT, JOURNAL_RESUME or JOURNAL_END
+	 */
+	uint8_t type;
+	/**
+	 * @brief depends on the type
+	 */
+	uint8_t detail;
+	/**
+	 * @brief depends on the type
+	 */
+	uint16_t count;
+	/**
+	 * @brief 0
+	 */
+	uint16_t reserved;
+};
+
+/**
+ * @brief the payload of JOURNAL_CHECKPOINT and JOURNAL_RESUME
+ */
+struct journal_checkpoint
+{
+	/**
+	 * @brief the number of moves of the game so far
+	 */
+	uint64_t moves;
+	/**
+	 * @brief the random numbers of the game after these moves
+	 */
+	rng_state rng;
+	/**
+	 * @brief the rows of the board after these moves
+	 */
+	uint32_t rows[FIELD_SIZE_MAX];
+};
+
+/**
+ * @brief the moves of a game that are not written yet
+ */
+struct journal_buffer
+{
+	/**
+	 * @brief the number of moves of the game
+	 */
+	uint64_t moves;
+	/**
+	 * @brief the number of moves in packed
+	 */
+	uint32_t pending;
+	/**
+	 * @brief the moves with 2 bits each
+	 */
+	uint8_t packed[JOURNAL_BLOCK_MOVES / 4];
+};
+
+/* === PROTOTYPES === */
+
+/**
+ * @brief writes the start of a new game
+ * @param fd the journal, nothing is written if it is negative
+ * @param id the id of the game
+ * @param game the game right after it was seeded, its buffer is reset
+ * @param power_of_two the power of two to win
+ */
+void journal_start(int fd, uint16_t id, struct shared_game *game, unsigned int power_of_two);
+
+/**
+ * @brief writes the state of a paused game that gets a client again
+ * @param fd the journal, nothing is written if it is negative
+ * @param id the id of the game
+ * @param game the game
+ * @param power_of_two the power of two to win from now on
+ */
+void journal_resume(int fd, uint16_t id, struct shared_game *game, unsigned int power_of_two);
+
+/**
+ * @brief appends a move to the buffer of a game and writes the buffer if it is full
+ * @details a checkpoint follows every JOURNAL_CHECKPOINT_MOVES moves
+ * @param fd the journal, nothing is written if it is negative
+ * @param id the id of the game
+ * @param game the game after the move
+ * @param command CMD_LEFT, CMD_RIGHT, CMD_UP or CMD_DOWN
+ * @param power_of_two the power of two to win
+ */
+void journal_move(int fd, uint16_t id, struct shared_game *game, unsigned int command, unsigned int power_of_two);
+
+/**
+ * @brief writes the buffered moves and the end of a game or a pause
+ * @param fd the journal, nothing is written if it is negative
+ * @param id the id of the game
+ * @param game the game
+ * @param status the last status
+ */
+void journal_end(int fd, uint16_t id, struct shared_game *game, unsigned int status);
+
+/**
+ * @brief reads the next record of a journal
+ * @param file the journal
+ * @param record the header of the record
+ * @param payload the payload, at least sizeof(struct journal_checkpoint) bytes
+ * @return 1 if a record was read, 0 at the end of the journal, -1 if the journal is cut off or corrupt
+ */
+int journal_read(FILE *file, struct journal_record *record, uint8_t *payload);
+
+#endif /*ifndef dp_journal_h*/
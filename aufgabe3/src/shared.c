@@ -6,6 +6,12 @@
  */
 
 #include "shared.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <sched.h>
 
 /**
  * @brief This variable is set to ensure cleanup is performed only once
@@ -23,37 +29,39 @@ int shm_id_game = -1;
 int shm_id_clients = -1;
 
 /**
- * @brief semaphore for the client connection to the parent server
+ * @brief id for the shared memory of the statistics of the server
  */
-int sem_client = -1;
+int shm_id_stats = -1;
 
 /**
- * @brief semaphore for the client connection to the parent server
+ * @brief frees the games of the server, NULL in the client
  */
-int sem_client2 = -1;
+void (*free_games)(void) = NULL;
 
-/**
- * @brief semaphore for the client connection to the game server that is responsible for one client
- */
-int s1 = -1;
-
-/**
- * @brief semaphore for the client connection to the game server that is responsible for one client
- */
-int s2 = -1;
+/* === STATIC FUNCTIONS === */
 
 /**
- * @brief semaphore for the client connection to the game server that is responsible for one client
+ * @brief the futex system call, glibc has no wrapper for it
+ * @param word the futex word
+ * @param op FUTEX_WAIT or FUTEX_WAKE, not private because the word is shared between processes
+ * @param value the expected value for FUTEX_WAIT, the number of waiters to wake for FUTEX_WAKE
+ * @return the result of the system call
  */
-int s3 = -1;
+static long futex(uint32_t *word, int op, uint32_t value)
+{
+    return syscall(SYS_futex, word, op, value, NULL, NULL, 0);
+}
 
 /**
- * @brief semaphore for the client connection to the game server that is responsible for one client
+ * @brief the round of an entry of a queue of queue_push
+ * @param position the index of the entry, it wraps around at 2^32
+ * @param size the number of entries of the queue
+ * @return the round in the high 16 bits, like the entry holds it
  */
-int s4 = -1;
-
-/* === STATIC FUNCTIONS === */
-
+static uint32_t queue_round(uint32_t position, uint32_t size)
+{
+    return (position / size) << 16;
+}
 
 /* === IMPLEMENTATIONS === */
 
@@ -90,7 +98,7 @@ void bail_out(int eval, const char *fmt, ...)
 
     pid = wait(&status);
     
-    if(WEXITSTATUS(status) != EXIT_SUCCESS){
+    if(pid > 0 && WEXITSTATUS(status) != EXIT_SUCCESS){
         (void) fprintf(stderr, "%s: ", program_name);
         (void) fprintf(stderr,"child with pid %d returned exit code %d.\n", pid, WEXITSTATUS(status));
         exit(EXIT_FAILURE);
@@ -117,15 +125,13 @@ void free_resources (void)
     /* clean up resources */
     DEBUG("Shutting down %s\n",program_name);
     
-    (void) semrm(sem_client);
-    (void) semrm(sem_client2);
-    (void) semrm(s1);
-    (void) semrm(s2);
-    (void) semrm(s3);
-    (void) semrm(s4);
+    if(free_games != NULL){
+        free_games();
+    }
 
     (void) shmctl(shm_id_game, IPC_RMID, NULL);
     (void) shmctl(shm_id_clients, IPC_RMID, NULL);
+    (void) shmctl(shm_id_stats, IPC_RMID, NULL);
 }
 
 void setup_signal_handler(void)
@@ -153,25 +159,6 @@ void clean_close(void)
 
     DEBUG("Clean Close %s\n",program_name);
 
-    if (semrm(sem_client) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore sem_client (semrm)");
-    }
-    if (semrm(sem_client2) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore sem_client2 (semrm)");
-    }
-    if (semrm(s1) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore 1 (semrm)");
-    }
-    if (semrm(s2) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore 2 (semrm)");
-    }
-    if (semrm(s3) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore 3 (semrm)");
-    }
-    if (semrm(s4) < 0) {
-        (void) bail_out(EXIT_FAILURE,"Error removing the semaphore 4 (semrm)");
-    }
-
     // Remove shm game
     if (shmctl(shm_id_game, IPC_RMID, NULL) < 0) {
         (void) bail_out(EXIT_FAILURE,"Error terminating shared memory of game (shmctl)");
@@ -185,22 +172,239 @@ void clean_close(void)
     exit(EXIT_SUCCESS);
 }
 
-void grab_semaphors( key_t key )
+struct shared_arena *map_arena(const char *path, bool create)
+{
+    int fd = open(path, create ? O_RDWR | O_CREAT : O_RDWR, PERMISSION);
+    if (fd < 0) {
+        return NULL;
+    }
+    /* growing keeps the slots of an existing file */
+    if (create && ftruncate(fd, sizeof(struct shared_arena)) < 0) {
+        (void) close(fd);
+        return NULL;
+    }
+    void *arena = mmap(NULL, sizeof(struct shared_arena), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    (void) close(fd);
+    return arena == MAP_FAILED ? NULL : arena;
+}
+
+uint16_t alloc_game(struct shared_arena *arena, unsigned int shard)
+{
+    uint64_t *free_head = &arena->free_head[shard];
+    uint64_t head = __atomic_load_n(free_head, __ATOMIC_ACQUIRE);
+    uint64_t next;
+    do {
+        uint32_t id = (uint32_t) head;
+        if (id == ID_UNSET) {
+            return ID_UNSET;
+        }
+        /* a stale next is harmless, the counter makes the exchange fail then */
+        next = ((head >> 32) + 1) << 32
+            | __atomic_load_n(&arena->games[id].next_free, __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(free_head, &head, next, true,
+        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+    (void) __atomic_fetch_add(&arena->number_clients, 1, __ATOMIC_RELAXED);
+    return (uint16_t) head;
+}
+
+void free_game(struct shared_arena *arena, uint16_t id)
+{
+    uint64_t *free_head = &arena->free_head[id % arena->shards];
+    uint64_t head = __atomic_load_n(free_head, __ATOMIC_RELAXED);
+    uint64_t next;
+    uint32_t state = GAME_OVER;
+
+    /* a slot must not be pushed twice, the exchange fails for a slot of a server that is gone */
+    if (final_state(&arena->games[id]) != GAME_OVER || !__atomic_compare_exchange_n(&arena->games[id].state, &state, GAME_FREE, false,
+        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    (void) __atomic_fetch_sub(&arena->number_clients, 1, __ATOMIC_RELAXED);
+    do {
+        __atomic_store_n(&arena->games[id].next_free, (uint32_t) head, __ATOMIC_RELAXED);
+        next = ((head >> 32) + 1) << 32 | id;
+    } while (!__atomic_compare_exchange_n(free_head, &head, next, true,
+        __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+uint32_t final_state(struct shared_game *game)
+{
+    uint32_t state;
+
+    /* the worker publishes the state right after the last status, a server that dies in between leaves GAME_ON */
+    for (int i = 0; (state = __atomic_load_n(&game->state, __ATOMIC_ACQUIRE)) == GAME_ON && i < SEM_SPIN; ++i) {
+        (void) sched_yield();
+    }
+    return state;
+}
+
+uint16_t register_game(struct shared_server *server, uint16_t wanted, unsigned int width, unsigned int height)
+{
+    struct registration *request = NULL;
+    /* a paused game belongs to its shard, a new one to any shard */
+    struct shared_shard *shard = wanted != ID_UNSET ? game_shard(server, wanted) : &server->shard[getpid() % server->shards];
+    uint32_t index = __atomic_fetch_add(&shard->registration_hint, 1, __ATOMIC_RELAXED);
+
+    /* clients start at different slots, so they rarely compete for the same one */
+    for (uint32_t tries = 1; request == NULL; ++tries, ++index) {
+        struct registration *slot = &shard->registrations[index % REGISTRATION_SLOTS];
+        uint32_t state = REG_FREE;
+        if (__atomic_compare_exchange_n(&slot->state, &state, (uint32_t) getpid(), false,
+            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            request = slot;
+        } else if (tries % REGISTRATION_SLOTS == 0) {
+            /* a post without a request makes the server release the slots of dead clients */
+            shared_sem_post(&shard->registrations_posted);
+            (void) sched_yield();
+        }
+    }
+    request->id = wanted;
+    request->width = width;
+    request->height = height;
+    request->answered.count = 0;
+    request->answered.waiters = 0;
+    request->posted = monotonic_ns();
+
+    queue_push(shard->registration_queue, REGISTRATION_SLOTS, &shard->registration_tail,
+        (uint16_t) (request - shard->registrations) + 1);
+    shared_sem_post(&shard->registrations_posted);
+
+    shared_sem_wait(&request->answered);
+    uint16_t key = request->id;
+    __atomic_store_n(&request->state, REG_FREE, __ATOMIC_RELEASE);
+    return key;
+}
+
+void ring_push(struct game_ring *ring, uint8_t entry)
 {
-    s1 = semgrab(SEM_KEY + 5*key + 1);
-    if (s1 < 0) {
-        (void) bail_out(EXIT_FAILURE,"semgrab (1) failed");
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    ring->entries[tail % GAME_RING_SIZE] = entry;
+    /* sequentially consistent, the scheduled flag of the game is checked after it */
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_SEQ_CST);
+}
+
+int ring_pop(struct game_ring *ring)
+{
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    if (head == __atomic_load_n(&ring->tail, __ATOMIC_SEQ_CST)) {
+        return -1;
     }
-    s2 = semgrab(SEM_KEY + 5*key + 2);
-    if (s2 < 0) {
-        (void) bail_out(EXIT_FAILURE,"semgrab (2) failed");
+    int entry = ring->entries[head % GAME_RING_SIZE];
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return entry;
+}
+
+struct shared_shard *game_shard(struct shared_server *server, uint16_t id)
+{
+    return &server->shard[id % server->shards];
+}
+
+void schedule_game(struct shared_server *server, struct shared_game *game, uint16_t id)
+{
+    /* a worker that is still busy with the game sees the new commands itself */
+    if (__atomic_exchange_n(&game->scheduled, 1, __ATOMIC_SEQ_CST) == 0) {
+        struct shared_shard *shard = game_shard(server, id);
+        queue_push(shard->ready, READY_QUEUE_SIZE, &shard->ready_tail, id);
+        shared_sem_post(&shard->ready_posted);
     }
-    s3 = semgrab(SEM_KEY + 5*key + 3);
-    if (s3 < 0) {
-        (void) bail_out(EXIT_FAILURE,"semgrab (3) failed");
+}
+
+void queue_push(uint32_t *cells, uint32_t size, uint32_t *tail, uint16_t value)
+{
+    for (;;) {
+        uint32_t position = __atomic_load_n(tail, __ATOMIC_ACQUIRE);
+        uint32_t round = queue_round(position, size);
+        uint32_t entry = round;
+        if (__atomic_compare_exchange_n(&cells[position % size], &entry, round | value, false,
+            __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            (void) __atomic_compare_exchange_n(tail, &position, position + 1, false,
+                __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+            return;
+        }
+        /* another producer wrote the entry and may be gone before it moved the tail, an older round means a stale tail */
+        if ((entry & 0xFFFF0000) == round) {
+            (void) __atomic_compare_exchange_n(tail, &position, position + 1, false,
+                __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        }
     }
-    s4 = semgrab(SEM_KEY + 5*key + 4);
-    if (s4 < 0) {
-        (void) bail_out(EXIT_FAILURE,"semgrab (4) failed");
+}
+
+uint16_t queue_pop(uint32_t *cells, uint32_t size, uint32_t *head)
+{
+    uint32_t *cell = &cells[*head % size];
+    uint32_t entry = __atomic_load_n(cell, __ATOMIC_ACQUIRE);
+
+    if ((entry & 0xFFFF0000) != queue_round(*head, size) || (entry & 0xFFFF) == 0) {
+        return 0;
     }
-}
\ No newline at end of file
+    /* the entry is empty for its next round */
+    __atomic_store_n(cell, queue_round(*head + size, size), __ATOMIC_RELEASE);
+    ++*head;
+    return entry & 0xFFFF;
+}
+
+void shared_sem_post(struct shared_sem *sem)
+{
+    (void) __atomic_fetch_add(&sem->count, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&sem->waiters, __ATOMIC_SEQ_CST) > 0) {
+        (void) futex(&sem->count, FUTEX_WAKE, 1);
+    }
+}
+
+bool shared_sem_trywait(struct shared_sem *sem)
+{
+    uint32_t count = __atomic_load_n(&sem->count, __ATOMIC_RELAXED);
+    while (count > 0) {
+        if (__atomic_compare_exchange_n(&sem->count, &count, count - 1, true,
+            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void shared_sem_wait(struct shared_sem *sem)
+{
+    for (int i = 0; i < SEM_SPIN; ++i) {
+        if (shared_sem_trywait(sem)) {
+            return;
+        }
+    }
+    while (!shared_sem_trywait(sem)) {
+        /* a post after the waiters are counted wakes the futex or changes the count before the wait */
+        (void) __atomic_fetch_add(&sem->waiters, 1, __ATOMIC_SEQ_CST);
+        (void) futex(&sem->count, FUTEX_WAIT, 0);
+        (void) __atomic_fetch_sub(&sem->waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+uint64_t monotonic_ns(void)
+{
+    struct timespec now;
+
+    (void) clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+long parse_number(const char *arg, const char *name, long min, long max)
+{
+    char *endptr;
+    long value;
+
+    errno = 0;
+    value = strtol(arg, &endptr, 10);
+    if((errno == ERANGE && (value == LONG_MAX || value == LONG_MIN))
+        || (errno != 0 && value == 0)) {
+        bail_out(EXIT_FAILURE, "parsing of %s failed! (strtol)", name);
+    }
+    if(endptr == arg){ bail_out(EXIT_FAILURE, "parsing of %s failed! (strtol) No digits were found.", name); }
+
+    if(*endptr != '\0'){
+        bail_out(EXIT_FAILURE, "Further characters after <%s>: %s", name, endptr);
+    }
+    if(value < min || value > max){
+        bail_out(EXIT_FAILURE, "Use a valid %s range (%ld-%ld)", name, min, max);
+    }
+    return value;
+}
@@ -19,8 +19,9 @@
 #include <string.h>
 #include <signal.h>
 #include <unistd.h>
-#include <sem182.h>
+#include <limits.h>
 #include "commands.h"
+#include "journal.h"
 
 /* === CONSTANTS === */
 
@@ -62,6 +63,26 @@
  * @brief an offset of the keys of the shared memory
  */
 #define SHM_KEY					(112233)
+/**
+ * @def ARENA_FILE_DEFAULT
+ * @brief the default file that holds all games, paused games in it survive restarts of the server and the host
+ */
+#define ARENA_FILE_DEFAULT		"2048-games.dat"
+/**
+ * @def ARENA_MAGIC
+ * @brief marks a file as a 2048 arena ("2048" in ASCII)
+ */
+#define ARENA_MAGIC				(0x32303438)
+/**
+ * @def ARENA_VERSION
+ * @brief the version of the layout of the arena file, files of another version are reset
+ */
+#define ARENA_VERSION			(5)
+/**
+ * @def STATS_KEY
+ * @brief the key of the shared memory with the statistics of the server
+ */
+#define STATS_KEY				(SHM_KEY + 1)
 /**
  * @def SEM_KEY
  * @brief an offset of the keys of the semaphores
@@ -72,6 +93,98 @@
  * @brief The permission of the semaphores and the shared memory 
  */
 #define PERMISSION				(0600)
+/**
+ * @def STATS_PERMISSION
+ * @brief The permission of the statistics, everybody may read them
+ */
+#define STATS_PERMISSION		(0644)
+
+/**
+ * @def WORKERS_MAX
+ * @brief The maximum number of worker threads of the server
+ */
+#define WORKERS_MAX				(64)
+
+/**
+ * @def SHARDS_MAX
+ * @brief The maximum number of server processes. Every shard owns the games whose id modulo the number of shards is its index
+ */
+#define SHARDS_MAX				(16)
+
+/**
+ * @def STATS_THREADS
+ * @brief The number of counter slots of the statistics: every shard has one slot for its main thread followed by one for every worker
+ */
+#define STATS_THREADS			(WORKERS_MAX + 1)
+
+/**
+ * @def STATS_LATENCY_BUCKETS
+ * @brief The number of buckets of the histogram of the handshake latencies. Bucket 0 counts handshakes below 1 microsecond,
+ * bucket i the ones from 2^(i-1) up to 2^i microseconds and the last one all longer ones
+ */
+#define STATS_LATENCY_BUCKETS	(24)
+
+/**
+ * @def READY_QUEUE_SIZE
+ * @brief The size of the ready queue of the server. Only games that are not scheduled yet are put into the queue, so it never overflows
+ */
+#define READY_QUEUE_SIZE		(ID_MAX + 1)
+
+/**
+ * @def SEM_SPIN
+ * @brief The number of tries of shared_sem_wait before it sleeps on the futex
+ */
+#define SEM_SPIN				(1000)
+
+/**
+ * @def REGISTRATION_SLOTS
+ * @brief The number of clients that can register at the same time, a power of two
+ */
+#define REGISTRATION_SLOTS		(256)
+
+/**
+ * @def REG_FREE
+ * @brief The state of a registration slot no client uses, a claimed slot holds the process id of its client
+ */
+#define REG_FREE				(0)
+
+/**
+ * @def ARENA_SLOTS
+ * @brief The number of game slots of the arena. The slot of a game is its id, slot ID_UNSET is never used
+ */
+#define ARENA_SLOTS				(ID_MAX + 1)
+
+/**
+ * @def GAME_FREE
+ * @brief The state of a slot that is in the free list
+ */
+#define GAME_FREE				(0)
+/**
+ * @def GAME_ON
+ * @brief The state of a slot of a game with a client
+ */
+#define GAME_ON					(1)
+/**
+ * @def GAME_PAUSED
+ * @brief The state of a slot of a paused game
+ */
+#define GAME_PAUSED				(2)
+/**
+ * @def GAME_OVER
+ * @brief The state of a slot of a finished game until the client read the last status
+ */
+#define GAME_OVER				(3)
+/**
+ * @def GAME_CLOSED
+ * @brief The state of a slot of a game the server deleted at shutdown, the next server frees it and not the client
+ */
+#define GAME_CLOSED				(4)
+
+/**
+ * @def GAME_RING_SIZE
+ * @brief The size of the command and the status ring of a game, a power of two. A client has at most GAME_RING_SIZE - 1 commands in flight
+ */
+#define GAME_RING_SIZE			(32)
 
 /* === MACROS === */
 
@@ -90,32 +203,46 @@
  */
 #define COUNT_OF(x) (sizeof(x)/sizeof(x[0]))
 
+/* === GLOBAL VARIABLES === */
+
 /**
- * @def MY_P(x,y)
- * @brief Decreases semaphore x with 1 and locks if it is negative. If there is an error the program closes controlled
+ * @brief Program name for usage and error messages
  */
-#define MY_P(x,y) do{\
- if (P(x) < 0) {\
- 	(void) bail_out(EXIT_FAILURE,"Semaphore P %s",y);\
- }\
-} while(0)
+const char * program_name;
 
 /**
- * @def MY_V(x,y)
- * @brief Increases semaphore x with 1. If there is an error the program closes controlled
+ * @brief a counting semaphore in shared memory, built on a futex so that posts and waits without contention need no system call
  */
-#define MY_V(x,y) do{\
- if (V(x) < 0) {\
- 	(void) bail_out(EXIT_FAILURE,"Semaphore V %s",y);\
- }\
-} while(0)
-
-/* === GLOBAL VARIABLES === */
+struct shared_sem
+{
+	/**
+	 * @brief the value of the semaphore, it is the futex word
+	 */
+	uint32_t count;
+	/**
+	 * @brief the number of processes and threads that sleep on the futex
+	 */
+	uint32_t waiters;
+};
 
 /**
- * @brief Program name for usage and error messages
+ * @brief a single producer single consumer ring of commands or statuses
  */
-const char * program_name;
+struct game_ring
+{
+	/**
+	 * @brief the next entry the consumer reads
+	 */
+	uint32_t head;
+	/**
+	 * @brief the next entry the producer writes
+	 */
+	uint32_t tail;
+	/**
+	 * @brief the entries, indexed modulo GAME_RING_SIZE
+	 */
+	uint8_t entries[GAME_RING_SIZE];
+};
 
 /**
  * @brief the shared struct of a game
@@ -123,17 +250,154 @@ const char * program_name;
 struct shared_game 
 {
 	/**
-	 * @brief the game field
+	 * @brief the game field with the size the client asked for
+	 */
+	struct board field;
+	/**
+	 * @brief the seed the game started with
+	 */
+	uint64_t seed;
+	/**
+	 * @brief the random numbers of the new tiles of the game
+	 */
+	rng_state rng;
+	/**
+	 * @brief the moves of the game that are not in the journal yet
+	 */
+	struct journal_buffer journal;
+	/**
+	 * @brief the commands from the client
+	 */
+	struct game_ring commands;
+	/**
+	 * @brief the game statuses for the client, one for every command
+	 */
+	struct game_ring statuses;
+	/**
+	 * @brief posted by the server for every status it writes
+	 */
+	struct shared_sem status_posted;
+	/**
+	 * @brief 1 while the game is in the ready queue or a worker handles its commands
+	 */
+	uint32_t scheduled;
+	/**
+	 * @brief GAME_FREE, GAME_ON, GAME_PAUSED, GAME_OVER or GAME_CLOSED
+	 */
+	uint32_t state;
+	/**
+	 * @brief the next slot of the free list while the slot is free
+	 */
+	uint32_t next_free;
+};
+
+/**
+ * @brief the memory mapped file that holds the slots of all games
+ */
+struct shared_arena
+{
+	/**
+	 * @brief ARENA_MAGIC if the file holds an arena
+	 */
+	uint32_t magic;
+	/**
+	 * @brief the ARENA_VERSION of the layout
+	 */
+	uint32_t version;
+	/**
+	 * @brief the size of one slot, a file of a build with another slot layout is reset
+	 */
+	uint32_t slot_size;
+	/**
+	 * @brief the number of slots, ARENA_SLOTS
+	 */
+	uint32_t slots;
+	/**
+	 * @brief the number of shards of the server that uses the arena
+	 */
+	uint32_t shards;
+	/**
+	 * @brief the first slot of the free list of every shard in the lower 32 bits and a counter against ABA in the upper 32 bits
+	 */
+	uint64_t free_head[SHARDS_MAX];
+	/**
+	 * @brief the number of games that are not free
+	 */
+	uint32_t number_clients;
+	/**
+	 * @brief the slots of the games indexed by their id
+	 */
+	struct shared_game games[ARENA_SLOTS];
+};
+
+/**
+ * @brief a request of a client to start a new game or to get back to a paused one
+ */
+struct registration
+{
+	/**
+	 * @brief the time the client put the request into the queue, from monotonic_ns
 	 */
-	struct tile field[FIELD_SIZE_Y][FIELD_SIZE_X];
+	uint64_t posted;
 	/**
-	 * @brief the game status for the client
+	 * @brief REG_FREE or the process id of the client that claimed the slot, the server releases the slot if the client dies
 	 */
-    unsigned int status;
-    /**
-	 * @brief the command from the client
+	uint32_t state;
+	/**
+	 * @brief the id of the paused game or ID_UNSET for a new game, the server answers with the id of the game or ID_UNSET if it can not be opened
+	 */
+	uint16_t id;
+	/**
+	 * @brief the width of a new game
+	 */
+	uint8_t width;
+	/**
+	 * @brief the height of a new game
+	 */
+	uint8_t height;
+	/**
+	 * @brief posted by the server when the answer is written
+	 */
+	struct shared_sem answered;
+};
+
+/**
+ * @brief the registration channel and the ready queue of one server process
+ */
+struct shared_shard
+{
+	/**
+	 * @brief the slots for the requests of the clients
 	 */
-    unsigned int command;
+	struct registration registrations[REGISTRATION_SLOTS];
+	/**
+	 * @brief where clients start to look for a free registration slot
+	 */
+	uint32_t registration_hint;
+	/**
+	 * @brief counts the requests in the registration queue
+	 */
+	struct shared_sem registrations_posted;
+	/**
+	 * @brief the next free entry of the registration queue, see queue_push
+	 */
+	uint32_t registration_tail;
+	/**
+	 * @brief the indices of the requested registration slots plus one and the rounds of the entries, see queue_push. There is one entry for every slot, so it never overflows
+	 */
+	uint32_t registration_queue[REGISTRATION_SLOTS];
+	/**
+	 * @brief counts the games in the ready queue
+	 */
+	struct shared_sem ready_posted;
+	/**
+	 * @brief the next free entry of the ready queue, see queue_push
+	 */
+	uint32_t ready_tail;
+	/**
+	 * @brief the ids of the scheduled games and the rounds of the entries, see queue_push
+	 */
+	uint32_t ready[READY_QUEUE_SIZE];
 };
 
 /**
@@ -142,16 +406,101 @@ struct shared_game
 struct shared_server
 {
 	/**
-	 * @brief the id of the new client or an old one getting back to a game
+	 * @brief the absolute path of the arena file
 	 */
-	uint16_t id;
+	char arena_path[PATH_MAX];
 	/**
-	 * @brief the number of clients
+	 * @brief the number of shards, a client routes a game by its id modulo this number
 	 */
-	uint16_t number_clients;
+	uint32_t shards;
+	/**
+	 * @brief the shards, each served by a process of its own
+	 */
+	struct shared_shard shard[SHARDS_MAX];
 };
 
 
+/**
+ * @brief the counters of one thread of the server. Only this thread writes them, with relaxed atomic stores
+ * @details 128 bytes, so the counters of two threads are never in the same cache line
+ */
+struct stats_counters
+{
+	/**
+	 * @brief the number of moves
+	 */
+	uint64_t moves;
+	/**
+	 * @brief the number of new games
+	 */
+	uint64_t created;
+	/**
+	 * @brief the number of paused games that got a client again
+	 */
+	uint64_t resumed;
+	/**
+	 * @brief the number of registrations that were refused
+	 */
+	uint64_t refused;
+	/**
+	 * @brief the number of games that were paused
+	 */
+	uint64_t paused;
+	/**
+	 * @brief the number of games that were won
+	 */
+	uint64_t won;
+	/**
+	 * @brief the number of games that were lost
+	 */
+	uint64_t lost;
+	/**
+	 * @brief the number of games that were deleted
+	 */
+	uint64_t deleted;
+	/**
+	 * @brief the nanoseconds the thread waited on its semaphore for work
+	 */
+	uint64_t wait_ns;
+	/**
+	 * @brief the start of the wait the thread is in, 0 while it works. A reader adds the running wait to wait_ns
+	 */
+	uint64_t wait_since;
+	/**
+	 * @brief fills the counters up to 128 bytes
+	 */
+	uint64_t reserved[6];
+};
+
+/**
+ * @brief the shared memory with the statistics of the server, 2048-stat attaches it read-only
+ * @details the game counters are summed over all threads. The number of active games is
+ * created + resumed - paused - won - lost - deleted, the number of paused games is paused_start + paused - resumed
+ */
+struct shared_stats
+{
+	/**
+	 * @brief the counters of the threads, first so that they start at a page boundary
+	 */
+	struct stats_counters threads[STATS_THREADS];
+	/**
+	 * @brief the number of handshakes in every bucket of the latency histogram, written by the main threads with atomic increments
+	 */
+	uint64_t handshakes[STATS_LATENCY_BUCKETS];
+	/**
+	 * @brief the time the server started, from monotonic_ns
+	 */
+	uint64_t started;
+	/**
+	 * @brief the number of worker threads of all shards
+	 */
+	uint32_t workers;
+	/**
+	 * @brief the number of paused games in the arena when the server started
+	 */
+	uint32_t paused_start;
+};
+
 /* === PROTOTYPES === */
 
 /**
@@ -166,13 +515,13 @@ void bail_out(int eval, const char *fmt, ...);
 
 /**
  * @brief free allocated resources
- * @details global variables: terminating, shm_id_game, shm_id_clients, s1, s2, s3, s4, sem_client, sem_client2
+ * @details global variables: terminating, shm_id_game, shm_id_clients
  */
 void free_resources(void);
 
 /**
  * @brief free allocated resources but prints error messages if something fails
- * @details global variables: shm_id_game, shm_id_clients, s1, s2, s3, s4, sem_client, sem_client2
+ * @details global variables: shm_id_game, shm_id_clients
  */
 void clean_close(void);
 
@@ -189,11 +538,132 @@ void setup_signal_handler(void);
 void signal_handler(int sig);
 
 /**
- * @brief Gets the semaphors that should got initialized by the server
- * @param key the id of the game
- * @details s1,s2,s3,s4
+ * @brief maps the arena file into memory
+ * @param path the path of the file
+ * @param create true to create the file if it does not exist and to grow it to the size of the arena
+ * @return the arena, NULL if the file can not be opened or mapped
+ */
+struct shared_arena *map_arena(const char *path, bool create);
+
+/**
+ * @brief takes a slot from the free list of a shard, lock-free
+ * @param arena the arena
+ * @param shard the index of the shard
+ * @return the id of the slot, ID_UNSET if all slots of the shard are used
+ */
+uint16_t alloc_game(struct shared_arena *arena, unsigned int shard);
+
+/**
+ * @brief puts the slot of a finished game back into the free list of its shard, lock-free
+ * @details only a slot in GAME_OVER is freed, see final_state. A slot the server closed at shutdown or a rebuilt free list already holds is left alone
+ * @param arena the arena
+ * @param id the id of the slot
+ */
+void free_game(struct shared_arena *arena, uint16_t id);
+
+/**
+ * @brief waits until the worker published the state of a game after its last status
+ * @details the worker writes the state after the last status, so a client that read it may still see GAME_ON for a moment
+ * @param game the game
+ * @return the state, GAME_ON if the server did not publish another one
+ */
+uint32_t final_state(struct shared_game *game);
+
+/**
+ * @brief asks the server to start a new game or to reconnect to a paused one, it waits for a free registration slot and the answer
+ * @param server the shared memory of the server
+ * @param wanted the id of the paused game or ID_UNSET for a new game
+ * @param width the number of tiles of a row of a new game
+ * @param height the number of rows of a new game
+ * @return the id of the game, ID_UNSET if the server could not open it
+ */
+uint16_t register_game(struct shared_server *server, uint16_t wanted, unsigned int width, unsigned int height);
+
+/**
+ * @brief appends an entry to a ring, the producer makes sure that it is not full
+ * @param ring the ring
+ * @param entry the command or status
+ */
+void ring_push(struct game_ring *ring, uint8_t entry);
+
+/**
+ * @brief takes the oldest entry of a ring
+ * @param ring the ring
+ * @return the entry, -1 if the ring is empty
+ */
+int ring_pop(struct game_ring *ring);
+
+/**
+ * @brief finds the shard that owns a game
+ * @param server the shared memory of the server
+ * @param id the id of the game
+ * @return the shard
+ */
+struct shared_shard *game_shard(struct shared_server *server, uint16_t id);
+
+/**
+ * @brief puts a game into the ready queue of its shard if it is not scheduled yet, called after its commands are in the ring
+ * @param server the shared memory of the server
+ * @param game the game
+ * @param id the id of the game
+ */
+void schedule_game(struct shared_server *server, struct shared_game *game, uint16_t id);
+
+/**
+ * @brief appends a value to a queue in shared memory that many processes write, lock-free
+ * @details an entry holds the value in its low 16 bits and the round of its index in the high 16 bits, an entry of
+ * zeros is empty for the first round. The entry is reserved and written with one exchange, so a producer that dies
+ * leaves no entry behind that a consumer would wait for. The producer makes sure that the queue is not full
+ * @param cells the entries of the queue
+ * @param size the number of entries, a power of two
+ * @param tail the next free entry, the next producer moves it if the producer of the entry is gone
+ * @param value the value, not 0
+ */
+void queue_push(uint32_t *cells, uint32_t size, uint32_t *tail, uint16_t value);
+
+/**
+ * @brief takes the oldest value of a queue of queue_push, it never waits. The consumers of a queue take turns
+ * @param cells the entries of the queue
+ * @param size the number of entries, a power of two
+ * @param head the oldest entry of the queue, it is moved to the next one
+ * @return the value, 0 if the queue is empty
+ */
+uint16_t queue_pop(uint32_t *cells, uint32_t size, uint32_t *head);
+
+/**
+ * @brief increases a shared semaphore and wakes a sleeping waiter
+ * @param sem the semaphore
+ */
+void shared_sem_post(struct shared_sem *sem);
+
+/**
+ * @brief decreases a shared semaphore if it is not 0, it never sleeps
+ * @param sem the semaphore
+ * @return true if the semaphore was decreased
+ */
+bool shared_sem_trywait(struct shared_sem *sem);
+
+/**
+ * @brief decreases a shared semaphore, it spins SEM_SPIN times before it sleeps until the semaphore is posted
+ * @param sem the semaphore
+ */
+void shared_sem_wait(struct shared_sem *sem);
+
+/**
+ * @brief reads the monotonic clock, it is the same for all processes of the host
+ * @return the time in nanoseconds
+ */
+uint64_t monotonic_ns(void);
+
+/**
+ * @brief parses the number of a command line option and bails out if it is not valid
+ * @param arg the argument of the option
+ * @param name the name of the argument for error messages
+ * @param min the smallest valid value
+ * @param max the largest valid value
+ * @return the parsed number
  */
-void grab_semaphors( key_t key );
+long parse_number(const char *arg, const char *name, long min, long max);
 
 
 #endif /*ifndef dp_shared_h*/
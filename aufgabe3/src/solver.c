@@ -0,0 +1,327 @@
+/**
+ * @file solver.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief The expectimax solver of a 2048 game. It searches the four root moves in parallel threads
+ * @date 19.10.2026
+ */
+
+#include "solver.h"
+#include <math.h>
+#include <pthread.h>
+
+/* === CONSTANTS === */
+
+/**
+ * @brief the base score of every board, so boards without a move score worst
+ */
+#define SCORE_LOST_PENALTY		(200000.0f)
+
+/**
+ * @brief the weight of the number of empty tiles of a row
+ */
+#define SCORE_EMPTY_WEIGHT		(270.0f)
+
+/**
+ * @brief the weight of the number of possible merges of a row
+ */
+#define SCORE_MERGES_WEIGHT		(700.0f)
+
+/**
+ * @brief the weight of the penalty for rows that are not monotonic
+ */
+#define SCORE_MONOTONICITY_WEIGHT	(47.0f)
+
+/**
+ * @brief the weight of the penalty for large tiles that are not merged yet
+ */
+#define SCORE_SUM_WEIGHT		(11.0f)
+
+/**
+ * @brief the probability that a new tile is a 2 (see new_number_field)
+ */
+#define PROBABILITY_TWO			(0.75f)
+
+/* === TYPES === */
+
+/**
+ * @brief an entry of a transposition table
+ */
+struct cache_entry {
+	/**
+	 * @brief the board of the entry, 0 if the entry is empty
+	 */
+	bitboard board;
+	/**
+	 * @brief the expected score of the board
+	 */
+	float score;
+	/**
+	 * @brief the number of moves the board was searched ahead
+	 */
+	uint32_t depth;
+};
+
+/**
+ * @brief the state of the search of one root move
+ */
+struct search {
+	/**
+	 * @brief the transposition table
+	 */
+	struct cache_entry *cache;
+	/**
+	 * @brief the board after the root move
+	 */
+	bitboard board;
+	/**
+	 * @brief the number of moves to search after the root move
+	 */
+	int depth;
+	/**
+	 * @brief the expected score of the root move
+	 */
+	float score;
+	/**
+	 * @brief the thread of the search
+	 */
+	pthread_t thread;
+};
+
+/* === GLOBALS === */
+
+/**
+ * @brief the heuristic score of every row
+ */
+static float row_score[ROW_TABLE_SIZE];
+
+/**
+ * @brief one search for every root move
+ */
+static struct search searches[CMD_DOWN + 1];
+
+/* === PROTOTYPES === */
+
+/**
+ * @brief evaluates a board after a move over all possible new tiles
+ * @param search the search
+ * @param board the board
+ * @param depth the number of moves to search ahead
+ * @param probability the probability to reach the board
+ * @return the expected score
+ */
+static float score_chance(struct search *search, bitboard board, int depth, float probability);
+
+/* === IMPLEMENTATIONS === */
+
+/**
+ * @brief calculates the heuristic score of a row
+ * @param row the row, 4 bits per tile
+ * @return the score
+ */
+static float score_row(uint16_t row)
+{
+	unsigned int line[FIELD_SIZE_X];
+	float sum = 0;
+	int empty = 0;
+	int merges = 0;
+	int previous = 0;
+	int counter = 0;
+
+	for(int x = 0; x < FIELD_SIZE_X; ++x){
+		line[x] = (row >> (4 * x)) & 0xF;
+		sum += powf(line[x], 3.5f);
+		if(line[x] == 0){
+			++empty;
+		} else if(previous == line[x]){
+			++counter;
+		} else{
+			if(counter > 0){
+				merges += 1 + counter;
+			}
+			counter = 0;
+			previous = line[x];
+		}
+	}
+	if(counter > 0){
+		merges += 1 + counter;
+	}
+
+	float monotonicity_left = 0;
+	float monotonicity_right = 0;
+	for(int x = 1; x < FIELD_SIZE_X; ++x){
+		if(line[x - 1] > line[x]){
+			monotonicity_left += powf(line[x - 1], 4) - powf(line[x], 4);
+		} else{
+			monotonicity_right += powf(line[x], 4) - powf(line[x - 1], 4);
+		}
+	}
+
+	return SCORE_LOST_PENALTY
+		+ SCORE_EMPTY_WEIGHT * empty
+		+ SCORE_MERGES_WEIGHT * merges
+		- SCORE_MONOTONICITY_WEIGHT * fminf(monotonicity_left, monotonicity_right)
+		- SCORE_SUM_WEIGHT * sum;
+}
+
+/**
+ * @brief calculates the heuristic score of a board from its rows and columns
+ * @param board the board
+ * @return the score
+ */
+static float score_board(bitboard board)
+{
+	bitboard transposed = transpose_board(board);
+	float score = 0;
+	for(int y = 0; y < FIELD_SIZE_Y; ++y){
+		score += row_score[(board >> (16 * y)) & 0xFFFF];
+		score += row_score[(transposed >> (16 * y)) & 0xFFFF];
+	}
+	return score;
+}
+
+/**
+ * @brief returns the slot of a board in a transposition table
+ * @param board the board
+ * @return the slot
+ */
+static size_t cache_slot(bitboard board)
+{
+	return (board * 0x9E3779B97F4A7C15ULL) >> (64 - SOLVER_CACHE_BITS);
+}
+
+/**
+ * @brief evaluates a board before a move with the best of the four moves
+ * @param search the search
+ * @param board the board
+ * @param depth the number of moves to search ahead
+ * @param probability the probability to reach the board
+ * @return the expected score of the best move, 0 if no tile can move
+ */
+static float score_move(struct search *search, bitboard board, int depth, float probability)
+{
+	float best = 0;
+	for(unsigned int command = CMD_LEFT; command <= CMD_DOWN; ++command){
+		bitboard moved = move_board(board, command);
+		if(moved != board){
+			best = fmaxf(best, score_chance(search, moved, depth - 1, probability));
+		}
+	}
+	return best;
+}
+
+static float score_chance(struct search *search, bitboard board, int depth, float probability)
+{
+	if(depth <= 0 || probability < SOLVER_MIN_PROBABILITY){
+		return score_board(board);
+	}
+
+	struct cache_entry *entry = &search->cache[cache_slot(board)];
+	if(entry->board == board && entry->depth >= depth){
+		return entry->score;
+	}
+
+	bitboard empty = empty_tiles(board);
+	int number_empty = __builtin_popcountll(empty);
+	float score = 0;
+
+	probability /= number_empty;
+	while(empty != 0){
+		bitboard tile = empty & -empty;
+		score += PROBABILITY_TWO
+			* score_move(search, board | tile, depth, probability * PROBABILITY_TWO);
+		score += (1 - PROBABILITY_TWO)
+			* score_move(search, board | (tile << 1), depth, probability * (1 - PROBABILITY_TWO));
+		empty &= empty - 1;
+	}
+	score /= number_empty;
+
+	entry->board = board;
+	entry->score = score;
+	entry->depth = depth;
+	return score;
+}
+
+/**
+ * @brief the thread function of the search of one root move
+ * @param argument the search
+ * @return NULL
+ */
+static void *run_search(void *argument)
+{
+	struct search *search = argument;
+	search->score = score_chance(search, search->board, search->depth, 1.0f);
+	return NULL;
+}
+
+int init_solver(void)
+{
+	init_gamelogic();
+	for(uint32_t row = 0; row < ROW_TABLE_SIZE; ++row){
+		row_score[row] = score_row(row);
+	}
+	for(unsigned int command = CMD_LEFT; command <= CMD_DOWN; ++command){
+		if(searches[command].cache == NULL){
+			searches[command].cache = calloc(1 << SOLVER_CACHE_BITS, sizeof(struct cache_entry));
+			if(searches[command].cache == NULL){
+				free_solver();
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+void free_solver(void)
+{
+	for(unsigned int command = CMD_LEFT; command <= CMD_DOWN; ++command){
+		free(searches[command].cache);
+		searches[command].cache = NULL;
+	}
+}
+
+int best_move(bitboard board, int depth)
+{
+	int candidates = 0;
+	int best = -1;
+
+	for(unsigned int command = CMD_LEFT; command <= CMD_DOWN; ++command){
+		searches[command].board = move_board(board, command);
+		searches[command].depth = depth - 1;
+		searches[command].score = -1;
+		if(searches[command].board != board){
+			++candidates;
+			best = command;
+		}
+	}
+	//nothing to compare
+	if(candidates <= 1){
+		return best;
+	}
+
+	//every root move gets its own thread, the last one runs in this thread
+	int started = 0;
+	for(unsigned int command = CMD_LEFT; command <= CMD_DOWN; ++command){
+		if(searches[command].board == board){
+			continue;
+		}
+		if(++started == candidates
+			|| pthread_create(&searches[command].thread, NULL, run_search, &searches[command]) != 0){
+			searches[command].thread = pthread_self();
+			(void) run_search(&searches[command]);
+		}
+	}
+	for(unsigned int command = CMD_LEFT; command <= CMD_DOWN; ++command){
+		if(searches[command].board != board
+			&& !pthread_equal(searches[command].thread, pthread_self())){
+			(void) pthread_join(searches[command].thread, NULL);
+		}
+	}
+
+	for(unsigned int command = CMD_LEFT; command <= CMD_DOWN; ++command){
+		if(searches[command].board != board && searches[command].score > searches[best].score){
+			best = command;
+		}
+	}
+	DEBUG("best move %d with score %f\n", best, searches[best].score);
+	return best;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file solver.h
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief The header file of the expectimax solver of a 2048 game
+ * @date 19.10.2026
+ */
+
+#ifndef dp_solver_h /*prevent multible inclusion*/
+#define dp_solver_h
+
+#include "gamelogic.h"
+
+/* === CONSTANTS === */
+
+/**
+ * @def SOLVER_DEFAULT_DEPTH
+ * @brief The default number of moves the solver looks ahead
+ */
+#define SOLVER_DEFAULT_DEPTH	(3)
+
+/**
+ * @def SOLVER_MAX_DEPTH
+ * @brief The maximum number of moves the solver looks ahead
+ */
+#define SOLVER_MAX_DEPTH		(8)
+
+/**
+ * @def SOLVER_CACHE_BITS
+ * @brief The transposition table of every search thread has 2^SOLVER_CACHE_BITS entries
+ */
+#define SOLVER_CACHE_BITS		(18)
+
+/**
+ * @def SOLVER_MIN_PROBABILITY
+ * @brief Chance nodes that are less probable are not searched deeper but evaluated by the heuristic
+ */
+#define SOLVER_MIN_PROBABILITY	(0.0001)
+
+/* === PROTOTYPES === */
+
+/**
+ * @brief builds the heuristic tables and the transposition tables of the solver
+ * @return 0 on success, -1 if no memory is left
+ */
+int init_solver(void);
+
+/**
+ * @brief frees the transposition tables of the solver
+ */
+void free_solver(void);
+
+/**
+ * @brief searches the best move of a board with expectimax
+ * @details every possible root move is searched by its own thread with its own transposition table.
+ * New tiles are 2 with probability 3/4 and 4 with probability 1/4, like in new_game and move_numbers_field.
+ * Not reentrant: only one search may run at a time
+ * @param board the board
+ * @param depth the number of moves to look ahead {1,...,SOLVER_MAX_DEPTH}
+ * @return CMD_LEFT, CMD_RIGHT, CMD_UP or CMD_DOWN, -1 if no tile can move
+ */
+int best_move(bitboard board, int depth);
+
+#endif /*ifndef dp_solver_h*/
@@ -0,0 +1,143 @@
+/**
+ * @file pause-loop.c
+ * @author David Pfahler (1126287) <e1126287@student.tuwien.ac.at>
+ * @brief A test of a running 2048-server: clients pause their games and reconnect to them in a tight loop
+ * @details every process plays one game. It sends a move and CMD_DISCONNECT and reconnects to the paused game as soon as it
+ * read ST_HALT. A stale status of the last session, a refused reconnect or a lost status fails the test, a hang is caught by
+ * the timeout of test.sh
+ * @date 19.10.2026
+ */
+
+#include "shared.h"
+#include <sys/mman.h>
+
+/* === GLOBALS === */
+
+/**
+ * @brief the pointer to the shared memory of a server
+ */
+static struct shared_server *server;
+
+/**
+ * @brief the pointer to the arena with the slots of all games
+ */
+static struct shared_arena *arena;
+
+/* === PROTOTYPES === */
+
+/**
+ * @brief sends one command to a game and waits for its status
+ * @param id the id of the game
+ * @param cmd the command
+ * @return the status
+ * @details server, arena
+ */
+static unsigned int play( uint16_t id, uint8_t cmd );
+
+/**
+ * @brief pauses a game and reconnects to it rounds times, a finished game is replaced by a new one
+ * @param rounds the number of reconnects
+ * @return the number of failures
+ * @details server, arena
+ */
+static int pause_loop( long rounds );
+
+/* === IMPLEMENTATIONS === */
+
+static unsigned int play( uint16_t id, uint8_t cmd )
+{
+	struct shared_game *game = &arena->games[id];
+
+	ring_push(&game->commands, cmd);
+	schedule_game(server, game, id);
+	shared_sem_wait(&game->status_posted);
+	return ring_pop(&game->statuses);
+}
+
+static int pause_loop( long rounds )
+{
+	int failures = 0;
+	uint16_t id = register_game(server, ID_UNSET, FIELD_SIZE_X, FIELD_SIZE_Y);
+
+	for(long i = 0; i < rounds && id != ID_UNSET; ++i){
+		unsigned int status = play(id, i % (CMD_DOWN + 1));
+		if(status == ST_WON || status == ST_LOST){
+			(void) free_game(arena, id);
+			id = register_game(server, ID_UNSET, FIELD_SIZE_X, FIELD_SIZE_Y);
+			continue;
+		}
+		if(status != ST_ON && status != ST_NOSUCHGAME){
+			fprintf(stderr, "%s: game %d got status %u for a move in round %ld\n", program_name, id, status, i);
+			++failures;
+		}
+		if((status = play(id, CMD_DISCONNECT)) != ST_HALT){
+			fprintf(stderr, "%s: game %d got status %u for a disconnect in round %ld\n", program_name, id, status, i);
+			++failures;
+		}
+		//like the client, the worker publishes GAME_PAUSED right after ST_HALT
+		if(final_state(&arena->games[id]) != GAME_PAUSED || register_game(server, id, 0, 0) != id){
+			fprintf(stderr, "%s: reconnect to game %d was refused in round %ld\n", program_name, id, i);
+			return failures + 1;
+		}
+	}
+	if(id == ID_UNSET){
+		fprintf(stderr, "%s: the server could not open a game\n", program_name);
+		return failures + 1;
+	}
+	if(play(id, CMD_DELETE) != ST_DELETE){
+		++failures;
+	}
+	(void) free_game(arena, id);
+	return failures;
+}
+
+/**
+ * Program entry point
+ * @brief Program entry point
+ * @param argc The argument counter
+ * @param argv The argument vector: the number of processes and the number of reconnects of every process
+ * @return EXIT_SUCCESS if all processes passed, EXIT_FAILURE otherwise
+ * @details global variables: program_name, server, arena
+*/
+int main(int argc, char ** argv) {
+	program_name = argv[0];
+	if(argc != 3){
+		(void) bail_out(EXIT_FAILURE, "USAGE: pause-loop processes rounds");
+	}
+	long processes = parse_number(argv[1], "processes", 1, 64);
+	long rounds = parse_number(argv[2], "rounds", 1, LONG_MAX);
+
+	int shm_id = shmget(SHM_KEY, sizeof(struct shared_server), PERMISSION);
+	if(shm_id < 0){
+		(void) bail_out(EXIT_FAILURE, "Could not access the shared memory! Is there a online server?");
+	}
+	server = shmat(shm_id, NULL, 0);
+	if(server == (struct shared_server*) -1){
+		(void) bail_out(EXIT_FAILURE, "shmat failed (server)");
+	}
+	arena = map_arena(server->arena_path, false);
+	if(arena == NULL){
+		(void) bail_out(EXIT_FAILURE, "can't map arena file %s", server->arena_path);
+	}
+
+	uint64_t start = monotonic_ns();
+	for(long i = 0; i < processes; ++i){
+		pid_t pid = fork();
+		if(pid < 0){
+			(void) bail_out(EXIT_FAILURE, "fork");
+		}
+		if(pid == 0){
+			_exit(pause_loop(rounds) == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+	}
+	int result = EXIT_SUCCESS;
+	int status;
+	while(wait(&status) > 0){
+		if(!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS){
+			result = EXIT_FAILURE;
+		}
+	}
+	printf("%ld processes paused and resumed their games %ld times each in %llu ms\n",
+		processes, rounds, (unsigned long long) ((monotonic_ns() - start) / 1000000));
+	return result;
+}
@@ -0,0 +1,31 @@
+#!/bin/sh
+# runs the checks against a server with an arena file of its own, call it in aufgabe3 after make
+
+echo ---------------------------
+echo Welcome to 2048 test!
+echo ---------------------------
+
+arena=$(mktemp)
+./2048-server -t 4 -f $arena &
+server=$!
+sleep 1
+
+i=1
+failed=0
+for check in "tests/pause-loop 4 5000"
+do
+    echo $check
+    if timeout 120 $check ; then
+      echo Check ${i} passed
+    else
+      echo Check ${i} failed
+      failed=1
+    fi
+    i=$((i + 1))
+    echo ---------------------------
+done
+
+kill -INT $server
+wait $server
+rm -f $arena
+exit $failed